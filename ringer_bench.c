@@ -0,0 +1,618 @@
+/*
+ * Copyright © 2009 Tyler Hayes
+ * ALL RIGHTS RESERVED
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file COPYING in the source
+ * distribution of this software for license terms.
+ *
+ * ringer-bench: benchmarks the Ringer plugin.
+ *
+ * Unlike unit_test_for_ringer.c, this links against sb_ringer.so and goes
+ * through ladspa_descriptor(), so it times the same run() a host would call.
+ * It sweeps the block size, the copy count, the buffer alignment and in-place
+ * vs. separate buffers, and prints one comma separated line per combination
+ * so the results of two releases can be diffed.
+ *
+ * With -p it runs the cache pollution test instead: a huge run() block (which
+ * would normally be written through the cache) followed by a small workload
+ * that should fit in the cache, with the plugin's streaming stores on and
+ * off.  The interesting number is how much slower the small workload gets
+ * right after the huge block.
+ *
+ * With -b it compares calling run() on BATCH_INSTANCES instances one at a
+ * time against one ringer_run_batch() call for all of them, at small block
+ * sizes.
+ *
+ * With -i it compares ringer_run_int16() and ringer_run_int24() against
+ * converting the whole buffer to floats, running run() on it and converting
+ * it back.
+ *
+ * With -g every test uses the generic fill kernel for every hold length
+ * instead of the ones specialized for common hold lengths, so running it with
+ * and without -g shows what the specialized kernels are worth.
+ *
+ * Usage: ringer-bench [-p | -b | -i] [-g] [-s samples_per_test]
+ */
+
+
+//----------------
+//-- INCLUSIONS --
+//----------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <ladspa.h>
+#include "sb_ringer.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define READ_CYCLES() __rdtsc()
+#else
+// no cycle counter, so cycles/sample is reported as 0
+#define READ_CYCLES() 0ULL
+#endif
+
+
+//-----------------------
+//-- DEFINED CONSTANTS --
+//-----------------------
+// port numbers of the mono Ringer plugin (see sb_ringer.c)
+#define RINGER_COPY_COUNT 0
+#define RINGER_INPUT 1
+#define RINGER_OUTPUT 2
+
+// smallest and largest block sizes tested (every power of 2 in between too)
+#define MIN_BLOCK 16
+#define MAX_BLOCK 65536
+// default number of samples run through the plugin for each test
+#define DEFAULT_SAMPLES_PER_TEST (1UL << 22)
+// each test is repeated this many times and the fastest time is kept
+#define REPEATS 3
+// buffers are allocated on this boundary; the "unaligned" tests start one
+// sample past it
+#define BUFFER_ALIGNMENT 64
+// cache pollution test: the huge block sizes, and the size of the small
+// workload's buffers (input and output together are 256 KB)
+#define MIN_HUGE_BLOCK (1UL << 20)
+#define MAX_HUGE_BLOCK (1UL << 24)
+#define RESIDENT_BLOCK 32768
+#define POLLUTION_REPEATS 5
+// batch test: number of instances (tracks), and the largest block size tried
+// (the instances share the MAX_BLOCK sample buffers, so the two multiplied
+// together can't be more than that)
+#define BATCH_INSTANCES 256
+#define MAX_BATCH_BLOCK (MAX_BLOCK / BATCH_INSTANCES)
+
+
+//---------------
+//-- FUNCTIONS --
+//---------------
+
+
+static double seconds_now()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Times run() for one combination of settings and prints the result line.
+ */
+static void run_test(const LADSPA_Descriptor * descriptor,
+                     LADSPA_Data * input_buffer, LADSPA_Data * output_buffer,
+                     unsigned long block_size, int copies, int misaligned,
+                     int in_place, unsigned long samples_per_test)
+{
+    LADSPA_Data copy_count = (LADSPA_Data) copies;
+    LADSPA_Data * input = input_buffer + misaligned;
+    LADSPA_Data * output = in_place ? input : output_buffer + misaligned;
+    unsigned long blocks = samples_per_test / block_size;
+    double best_seconds = 0.0;
+    unsigned long long best_cycles = 0;
+    LADSPA_Handle instance;
+    unsigned long i;
+    int repeat;
+
+    if (blocks == 0)
+        blocks = 1;
+
+    instance = descriptor->instantiate(descriptor, 48000);
+    if (!instance)
+        return;
+    descriptor->connect_port(instance, RINGER_COPY_COUNT, &copy_count);
+    descriptor->connect_port(instance, RINGER_INPUT, input);
+    descriptor->connect_port(instance, RINGER_OUTPUT, output);
+    descriptor->activate(instance);
+
+    // warm up the caches and the branch predictors
+    descriptor->run(instance, block_size);
+
+    for (repeat = 0; repeat < REPEATS; ++repeat)
+    {
+        double start = seconds_now();
+        unsigned long long start_cycles = READ_CYCLES();
+
+        for (i = 0; i < blocks; ++i)
+            descriptor->run(instance, block_size);
+
+        unsigned long long cycles = READ_CYCLES() - start_cycles;
+        double seconds = seconds_now() - start;
+
+        if (repeat == 0 || seconds < best_seconds)
+        {
+            best_seconds = seconds;
+            best_cycles = cycles;
+        }
+    }
+
+    descriptor->cleanup(instance);
+
+    const double samples = (double) blocks * block_size;
+
+    /*
+     * GB/s counts the bytes written to the output buffer, which is the
+     * memory traffic that matters here (the input is only read once per
+     * hold).
+     */
+    printf("%lu,%d,%s,%s,%.4f,%.4f,%.3f\n", block_size, copies,
+           misaligned ? "unaligned" : "aligned",
+           in_place ? "in-place" : "separate",
+           best_seconds * 1e9 / samples, best_cycles / samples,
+           samples * sizeof (LADSPA_Data) / best_seconds / 1e9);
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Runs one huge block through one instance, then times a cache-resident block
+ * through a second one (right after, and then again once it's warm), and
+ * prints the result line.
+ */
+static void run_pollution_test(const LADSPA_Descriptor * descriptor,
+                               unsigned long huge_block, int streaming)
+{
+    LADSPA_Data copy_count = 16.0f;
+    LADSPA_Data * huge_input;
+    LADSPA_Data * huge_output;
+    LADSPA_Data * resident_input;
+    LADSPA_Data * resident_output;
+    LADSPA_Handle huge_instance;
+    LADSPA_Handle resident_instance;
+    double best_huge = 0.0;
+    double best_cold = 0.0;
+    double best_warm = 0.0;
+    unsigned long i;
+    int repeat;
+
+    huge_input = (LADSPA_Data *) aligned_alloc(BUFFER_ALIGNMENT,
+            huge_block * sizeof (LADSPA_Data));
+    huge_output = (LADSPA_Data *) aligned_alloc(BUFFER_ALIGNMENT,
+            huge_block * sizeof (LADSPA_Data));
+    resident_input = (LADSPA_Data *) aligned_alloc(BUFFER_ALIGNMENT,
+            RESIDENT_BLOCK * sizeof (LADSPA_Data));
+    resident_output = (LADSPA_Data *) aligned_alloc(BUFFER_ALIGNMENT,
+            RESIDENT_BLOCK * sizeof (LADSPA_Data));
+    if (!huge_input || !huge_output || !resident_input || !resident_output)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    // touch everything so page faults aren't timed
+    for (i = 0; i < huge_block; ++i)
+    {
+        huge_input[i] = (LADSPA_Data) i / huge_block;
+        huge_output[i] = 0.0f;
+    }
+    for (i = 0; i < RESIDENT_BLOCK; ++i)
+    {
+        resident_input[i] = (LADSPA_Data) i / RESIDENT_BLOCK;
+        resident_output[i] = 0.0f;
+    }
+
+    huge_instance = descriptor->instantiate(descriptor, 48000);
+    resident_instance = descriptor->instantiate(descriptor, 48000);
+    if (!huge_instance || !resident_instance)
+        exit(1);
+    descriptor->connect_port(huge_instance, RINGER_COPY_COUNT, &copy_count);
+    descriptor->connect_port(huge_instance, RINGER_INPUT, huge_input);
+    descriptor->connect_port(huge_instance, RINGER_OUTPUT, huge_output);
+    descriptor->connect_port(resident_instance, RINGER_COPY_COUNT,
+                             &copy_count);
+    descriptor->connect_port(resident_instance, RINGER_INPUT, resident_input);
+    descriptor->connect_port(resident_instance, RINGER_OUTPUT,
+                             resident_output);
+    descriptor->activate(huge_instance);
+    descriptor->activate(resident_instance);
+
+    ringer_set_streaming_threshold(streaming ? MIN_HUGE_BLOCK : 0);
+
+    for (repeat = 0; repeat < POLLUTION_REPEATS; ++repeat)
+    {
+        // get the small workload's buffers into the cache
+        descriptor->run(resident_instance, RESIDENT_BLOCK);
+        descriptor->run(resident_instance, RESIDENT_BLOCK);
+
+        double start = seconds_now();
+        descriptor->run(huge_instance, huge_block);
+        double huge = seconds_now() - start;
+
+        start = seconds_now();
+        descriptor->run(resident_instance, RESIDENT_BLOCK);
+        double cold = seconds_now() - start;
+
+        start = seconds_now();
+        descriptor->run(resident_instance, RESIDENT_BLOCK);
+        double warm = seconds_now() - start;
+
+        if (repeat == 0 || huge < best_huge)
+            best_huge = huge;
+        if (repeat == 0 || cold < best_cold)
+            best_cold = cold;
+        if (repeat == 0 || warm < best_warm)
+            best_warm = warm;
+    }
+
+    // back to the default
+    ringer_set_streaming_threshold(0);
+
+    descriptor->cleanup(huge_instance);
+    descriptor->cleanup(resident_instance);
+    free(huge_input);
+    free(huge_output);
+    free(resident_input);
+    free(resident_output);
+
+    printf("%lu,%s,%.4f,%.4f,%.4f\n", huge_block, streaming ? "on" : "off",
+           best_huge * 1e9 / huge_block, best_cold * 1e9 / RESIDENT_BLOCK,
+           best_warm * 1e9 / RESIDENT_BLOCK);
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Times BATCH_INSTANCES instances run one at a time, then all in one
+ * ringer_run_batch() call, and prints a result line for each.
+ */
+static void run_batch_test(const LADSPA_Descriptor * descriptor,
+                           LADSPA_Data * input_buffer,
+                           LADSPA_Data * output_buffer,
+                           unsigned long block_size,
+                           unsigned long samples_per_test)
+{
+    static LADSPA_Handle instances[BATCH_INSTANCES];
+    LADSPA_Data copy_count = 16.0f;
+    unsigned long blocks = samples_per_test / block_size / BATCH_INSTANCES;
+    double best_seconds[2] = { 0.0, 0.0 };
+    unsigned long i;
+    unsigned long block;
+    int batched;
+    int repeat;
+
+    if (blocks == 0)
+        blocks = 1;
+
+    // every track gets its own stretch of the input and output buffers
+    for (i = 0; i < BATCH_INSTANCES; ++i)
+    {
+        instances[i] = descriptor->instantiate(descriptor, 48000);
+        if (!instances[i])
+            exit(1);
+        descriptor->connect_port(instances[i], RINGER_COPY_COUNT, &copy_count);
+        descriptor->connect_port(instances[i], RINGER_INPUT,
+                                 input_buffer + i * block_size);
+        descriptor->connect_port(instances[i], RINGER_OUTPUT,
+                                 output_buffer + i * block_size);
+        descriptor->activate(instances[i]);
+    }
+
+    for (repeat = 0; repeat < REPEATS; ++repeat)
+        for (batched = 0; batched < 2; ++batched)
+        {
+            double start = seconds_now();
+
+            for (block = 0; block < blocks; ++block)
+            {
+                if (batched)
+                    ringer_run_batch(instances, BATCH_INSTANCES, block_size);
+                else
+                    for (i = 0; i < BATCH_INSTANCES; ++i)
+                        descriptor->run(instances[i], block_size);
+            }
+
+            double seconds = seconds_now() - start;
+            if (repeat == 0 || seconds < best_seconds[batched])
+                best_seconds[batched] = seconds;
+        }
+
+    for (i = 0; i < BATCH_INSTANCES; ++i)
+        descriptor->cleanup(instances[i]);
+
+    const double samples = (double) blocks * block_size * BATCH_INSTANCES;
+    for (batched = 0; batched < 2; ++batched)
+        printf("%lu,%d,%s,%.4f\n", block_size, BATCH_INSTANCES,
+               batched ? "batch" : "run", best_seconds[batched] * 1e9 / samples);
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * The conversions a program without the integer PCM functions has to do
+ * around run().  The 24-bit samples are little-endian.
+ */
+static void int16_to_float(const int16_t * input, LADSPA_Data * output,
+                           unsigned long sample_count)
+{
+    unsigned long i;
+
+    for (i = 0; i < sample_count; ++i)
+        output[i] = input[i] * (1.0f / 32768.0f);
+}
+
+static void float_to_int16(const LADSPA_Data * input, int16_t * output,
+                           unsigned long sample_count)
+{
+    unsigned long i;
+
+    for (i = 0; i < sample_count; ++i)
+        output[i] = (int16_t) (input[i] * 32768.0f);
+}
+
+static void int24_to_float(const unsigned char * input, LADSPA_Data * output,
+                           unsigned long sample_count)
+{
+    unsigned long i;
+
+    for (i = 0; i < sample_count; ++i)
+    {
+        // shift the sign bit up to the top and back to sign-extend it
+        const int32_t sample = (int32_t) (((uint32_t) input[3 * i] << 8)
+                | ((uint32_t) input[3 * i + 1] << 16)
+                | ((uint32_t) input[3 * i + 2] << 24)) >> 8;
+        output[i] = sample * (1.0f / 8388608.0f);
+    }
+}
+
+static void float_to_int24(const LADSPA_Data * input, unsigned char * output,
+                           unsigned long sample_count)
+{
+    unsigned long i;
+
+    for (i = 0; i < sample_count; ++i)
+    {
+        const int32_t sample = (int32_t) (input[i] * 8388608.0f);
+        output[3 * i] = sample & 0xFF;
+        output[3 * i + 1] = (sample >> 8) & 0xFF;
+        output[3 * i + 2] = (sample >> 16) & 0xFF;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Times one integer format both ways for one copy count and prints a result
+ * line for each.  'bytes' is the size of one sample (2 or 3).
+ */
+static void run_pcm_test(const LADSPA_Descriptor * descriptor, int bytes,
+                         int copies, unsigned char * input,
+                         unsigned char * output, LADSPA_Data * scratch,
+                         unsigned long sample_count)
+{
+    LADSPA_Data copy_count = (LADSPA_Data) copies;
+    Ringer_pcm_state state;
+    LADSPA_Handle instance;
+    double best_seconds[2] = { 0.0, 0.0 };
+    int native;
+    int repeat;
+
+    instance = descriptor->instantiate(descriptor, 48000);
+    if (!instance)
+        exit(1);
+    descriptor->connect_port(instance, RINGER_COPY_COUNT, &copy_count);
+    descriptor->connect_port(instance, RINGER_INPUT, scratch);
+    descriptor->connect_port(instance, RINGER_OUTPUT, scratch);
+
+    for (repeat = 0; repeat < REPEATS; ++repeat)
+        for (native = 0; native < 2; ++native)
+        {
+            double start = seconds_now();
+
+            if (native)
+            {
+                ringer_pcm_reset(&state);
+                if (bytes == 2)
+                    ringer_run_int16(&state, (const int16_t *) input,
+                                     (int16_t *) output, sample_count,
+                                     copies);
+                else
+                    ringer_run_int24(&state, input, output, sample_count,
+                                     copies);
+            }
+            else
+            {
+                descriptor->activate(instance);
+                if (bytes == 2)
+                    int16_to_float((const int16_t *) input, scratch,
+                                   sample_count);
+                else
+                    int24_to_float(input, scratch, sample_count);
+                descriptor->run(instance, sample_count);
+                if (bytes == 2)
+                    float_to_int16(scratch, (int16_t *) output,
+                                   sample_count);
+                else
+                    float_to_int24(scratch, output, sample_count);
+            }
+
+            double seconds = seconds_now() - start;
+            if (repeat == 0 || seconds < best_seconds[native])
+                best_seconds[native] = seconds;
+        }
+
+    descriptor->cleanup(instance);
+
+    for (native = 0; native < 2; ++native)
+        printf("int%d,%d,%s,%.4f\n", bytes * 8, copies,
+               native ? "native" : "float+conversion",
+               best_seconds[native] * 1e9 / sample_count);
+}
+
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char * argv[])
+{
+    static const int copy_counts[] = { 5, 8, 16, 32, 64, 100, 128, 200 };
+    unsigned long samples_per_test = DEFAULT_SAMPLES_PER_TEST;
+    const LADSPA_Descriptor * descriptor;
+    LADSPA_Data * input_buffer;
+    LADSPA_Data * output_buffer;
+    unsigned long block_size;
+    unsigned long i;
+    int pollution = 0;
+    int batch = 0;
+    int pcm = 0;
+    int option;
+
+    while ((option = getopt(argc, argv, "pbigs:h")) != -1)
+    {
+        if (option == 's')
+            samples_per_test = strtoul(optarg, NULL, 10);
+        else if (option == 'p')
+            pollution = 1;
+        else if (option == 'b')
+            batch = 1;
+        else if (option == 'i')
+            pcm = 1;
+        else if (option == 'g')
+            ringer_use_kernels(RINGER_KERNELS_BEST
+                               | RINGER_KERNELS_GENERIC_HOLDS);
+        else
+        {
+            fprintf(stderr, "Usage: %s [-p | -b | -i] [-g] "
+                    "[-s samples_per_test]\n", argv[0]);
+            return option == 'h' ? 0 : 1;
+        }
+    }
+
+    descriptor = ladspa_descriptor(0);
+    if (!descriptor)
+    {
+        fprintf(stderr, "could not get the Ringer plugin descriptor\n");
+        return 1;
+    }
+
+    if (pollution)
+    {
+        printf("huge_block,streaming,huge_ns_per_sample,"
+               "resident_cold_ns_per_sample,resident_warm_ns_per_sample\n");
+        for (block_size = MIN_HUGE_BLOCK; block_size <= MAX_HUGE_BLOCK;
+             block_size *= 4)
+        {
+            run_pollution_test(descriptor, block_size, 0);
+            run_pollution_test(descriptor, block_size, 1);
+        }
+        return 0;
+    }
+
+    if (pcm)
+    {
+        // the whole test is done in one go, so the buffers are that big
+        unsigned char * pcm_input = (unsigned char *)
+                malloc(samples_per_test * 3);
+        unsigned char * pcm_output = (unsigned char *)
+                malloc(samples_per_test * 3);
+        LADSPA_Data * scratch = (LADSPA_Data *)
+                malloc(samples_per_test * sizeof (LADSPA_Data));
+        if (!pcm_input || !pcm_output || !scratch)
+        {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        for (i = 0; i < samples_per_test * 3; ++i)
+        {
+            pcm_input[i] = (unsigned char) rand();
+            pcm_output[i] = 0;
+        }
+        for (i = 0; i < samples_per_test; ++i)
+            scratch[i] = 0.0f;
+
+        printf("format,copy_count,path,ns_per_sample\n");
+        for (i = 0; i < sizeof (copy_counts) / sizeof (copy_counts[0]); ++i)
+        {
+            run_pcm_test(descriptor, 2, copy_counts[i], pcm_input, pcm_output,
+                         scratch, samples_per_test);
+            run_pcm_test(descriptor, 3, copy_counts[i], pcm_input, pcm_output,
+                         scratch, samples_per_test);
+        }
+
+        free(pcm_input);
+        free(pcm_output);
+        free(scratch);
+        return 0;
+    }
+
+    // one extra sample so the unaligned tests stay inside the buffers (the
+    // batch test splits the same buffers up between its instances)
+    const size_t buffer_size = (MAX_BLOCK + 1) * sizeof (LADSPA_Data);
+
+    input_buffer = (LADSPA_Data *) aligned_alloc(BUFFER_ALIGNMENT,
+            (buffer_size + BUFFER_ALIGNMENT - 1) & ~(BUFFER_ALIGNMENT - 1));
+    output_buffer = (LADSPA_Data *) aligned_alloc(BUFFER_ALIGNMENT,
+            (buffer_size + BUFFER_ALIGNMENT - 1) & ~(BUFFER_ALIGNMENT - 1));
+    if (!input_buffer || !output_buffer)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (i = 0; i <= MAX_BLOCK; ++i)
+    {
+        input_buffer[i] = (LADSPA_Data) i / MAX_BLOCK;
+        output_buffer[i] = 0.0f;
+    }
+
+    if (batch)
+    {
+        printf("block_size,instances,mode,ns_per_sample\n");
+        for (block_size = MIN_BLOCK; block_size <= MAX_BATCH_BLOCK;
+             block_size *= 2)
+            run_batch_test(descriptor, input_buffer, output_buffer,
+                           block_size, samples_per_test);
+        free(input_buffer);
+        free(output_buffer);
+        return 0;
+    }
+
+    printf("block_size,copy_count,alignment,placement,ns_per_sample,"
+           "cycles_per_sample,gb_per_s\n");
+
+    for (block_size = MIN_BLOCK; block_size <= MAX_BLOCK; block_size *= 2)
+        for (i = 0; i < sizeof (copy_counts) / sizeof (copy_counts[0]); ++i)
+        {
+            run_test(descriptor, input_buffer, output_buffer, block_size,
+                     copy_counts[i], 0, 0, samples_per_test);
+            run_test(descriptor, input_buffer, output_buffer, block_size,
+                     copy_counts[i], 1, 0, samples_per_test);
+            run_test(descriptor, input_buffer, output_buffer, block_size,
+                     copy_counts[i], 0, 1, samples_per_test);
+            run_test(descriptor, input_buffer, output_buffer, block_size,
+                     copy_counts[i], 1, 1, samples_per_test);
+        }
+
+    free(input_buffer);
+    free(output_buffer);
+    return 0;
+}
+
+// ------------------------------- EOF ----------------------------------------
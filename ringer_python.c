@@ -0,0 +1,410 @@
+/*
+ * Copyright © 2009 Tyler Hayes
+ * ALL RIGHTS RESERVED
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file COPYING in the source
+ * distribution of this software for license terms.
+ *
+ * ringer: a Python module that runs Ringer on anything that supports the
+ * buffer protocol (NumPy arrays, array.array, memoryview, bytearray, ...):
+ *
+ *     import ringer
+ *     ringer.run(samples, 40)              # in place
+ *     ringer.run(samples, 40, out)         # into 'out'
+ *
+ * The samples can be 32-bit floats or 16-bit integers, either 1-D (one
+ * channel) or 2-D (channels x frames, one channel per row).  The plugin reads
+ * and writes the Python objects' own memory, so nothing is copied (except
+ * float channels that aren't aligned like floats, see run_channels()), and
+ * the GIL is released while it runs so other Python threads can carry on.
+ *
+ * Floats go through the mono plugin's run() (linked from sb_ringer.so, like
+ * the other tools) and 16-bit samples through ringer_run_int16() (see
+ * sb_ringer.h), so the result is exactly what the plugin gives.
+ *
+ * Build it with 'make python'.
+ */
+
+
+//----------------
+//-- INCLUSIONS --
+//----------------
+// Python.h has to come first (it sets up some feature macros)
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ladspa.h>
+#include "sb_ringer.h"
+
+
+//-----------------------
+//-- DEFINED CONSTANTS --
+//-----------------------
+// port numbers of the mono Ringer plugin (see sb_ringer.c)
+#define RINGER_COPY_COUNT 0
+#define RINGER_INPUT 1
+#define RINGER_OUTPUT 2
+
+// default number of copies (same as the plugin's lower bound)
+#define DEFAULT_COPIES 5
+
+// what run_channels() returns if it fails
+#define NO_INSTANCE -1
+#define NO_MEMORY -2
+
+// the kinds of samples that can be processed
+#define SAMPLES_UNSUPPORTED 0
+#define SAMPLES_FLOAT32 1
+#define SAMPLES_INT16 2
+
+
+//---------------
+//-- FUNCTIONS --
+//---------------
+
+
+/*
+ * Works out the kind of samples from a buffer's struct-module format string,
+ * e.g. "f", "<f" or "=h".  A byte order is only accepted if it's the
+ * machine's own.
+ */
+static int sample_kind(const char * format, Py_ssize_t item_size)
+{
+    // no format means plain bytes
+    if (!format)
+        return SAMPLES_UNSUPPORTED;
+
+    if (*format == '@' || *format == '=')
+        ++format;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    else if (*format == '<')
+        ++format;
+#else
+    else if (*format == '>' || *format == '!')
+        ++format;
+#endif
+
+    if (!strcmp(format, "f") && item_size == 4)
+        return SAMPLES_FLOAT32;
+    if (!strcmp(format, "h") && item_size == 2)
+        return SAMPLES_INT16;
+    return SAMPLES_UNSUPPORTED;
+}
+
+
+/*
+ * Gets a buffer and checks it is something run() can handle: float32 or
+ * int16, 1-D or 2-D, and with each channel's samples next to each other
+ * (the channels themselves can be anywhere).  Returns its kind of samples,
+ * or SAMPLES_UNSUPPORTED after setting a Python exception.
+ */
+static int get_samples(PyObject * object, Py_buffer * view, int writable,
+                       const char * name)
+{
+    int kind;
+
+    if (PyObject_GetBuffer(object, view, PyBUF_STRIDES | PyBUF_FORMAT
+                           | (writable ? PyBUF_WRITABLE : 0)) < 0)
+        return SAMPLES_UNSUPPORTED;
+
+    kind = sample_kind(view->format, view->itemsize);
+    if (kind == SAMPLES_UNSUPPORTED)
+        PyErr_Format(PyExc_TypeError, "%s must hold float32 or int16 samples "
+                     "(format 'f' or 'h'), not '%s'", name,
+                     view->format ? view->format : "B");
+    else if (view->ndim != 1 && view->ndim != 2)
+        PyErr_Format(PyExc_ValueError, "%s must be 1-D (frames) or 2-D "
+                     "(channels x frames), not %d-D", name, view->ndim);
+    else if (view->strides[view->ndim - 1] != view->itemsize
+             && view->shape[view->ndim - 1] > 1)
+        PyErr_Format(PyExc_ValueError, "the frames of each channel of %s "
+                     "must be contiguous", name);
+    else
+        return kind;
+
+    PyBuffer_Release(view);
+    return SAMPLES_UNSUPPORTED;
+}
+
+
+/*
+ * Works out the range of memory a buffer from get_samples() covers, from the
+ * start of its lowest channel to the end of its highest one (the channels
+ * can be in either order, or anywhere in between).
+ */
+static void get_extent(const Py_buffer * view, const char ** start,
+                       const char ** end)
+{
+    const Py_ssize_t channel_bytes =
+            view->shape[view->ndim - 1] * view->itemsize;
+    const char * first = (const char *) view->buf;
+    const char * last = first;
+
+    if (view->ndim == 2 && view->shape[0] > 1)
+        last += (view->shape[0] - 1) * view->strides[0];
+
+    *start = first < last ? first : last;
+    *end = (first < last ? last : first) + channel_bytes;
+}
+
+
+/*
+ * Returns 1 if 'out' can be written while 'samples' is being read: either it
+ * is exactly the same buffer (in place, each channel over itself) or the two
+ * don't share any memory.  Anything in between (like a view of the same
+ * array shifted by a few frames) would have run() read samples it has
+ * already overwritten, so it isn't allowed.
+ */
+static int can_write_over(const Py_buffer * samples, const Py_buffer * out)
+{
+    const char * samples_start;
+    const char * samples_end;
+    const char * out_start;
+    const char * out_end;
+
+    if (samples->buf == out->buf
+        && (samples->ndim == 1 || samples->shape[0] <= 1
+            || samples->strides[0] == out->strides[0]))
+        return 1;
+
+    get_extent(samples, &samples_start, &samples_end);
+    get_extent(out, &out_start, &out_end);
+    return out_end <= samples_start || samples_end <= out_start;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Runs every channel (row) through Ringer, each one starting with a fresh
+ * hold as if the plugin had just been activated.  Called without the GIL, so
+ * it mustn't touch any Python objects.  Returns 0, NO_INSTANCE if a plugin
+ * instance couldn't be created, or NO_MEMORY.
+ *
+ * The plugin's float kernels need every sample aligned like a float, which a
+ * buffer doesn't have to be (e.g. a memoryview of a bytearray starting at an
+ * odd byte).  A float channel whose input or output isn't is copied into an
+ * aligned scratch buffer, processed in place there and copied back out.
+ */
+static int run_channels(const Py_buffer * input, const Py_buffer * output,
+                        int kind, int copies)
+{
+    const Py_ssize_t channel_count = input->ndim == 2 ? input->shape[0] : 1;
+    const Py_ssize_t frame_count = input->shape[input->ndim - 1];
+    const LADSPA_Descriptor * descriptor = NULL;
+    LADSPA_Handle instance = NULL;
+    LADSPA_Data copy_count = (LADSPA_Data) copies;
+    LADSPA_Data * scratch = NULL;
+    Py_ssize_t channel;
+
+    if (frame_count == 0)
+        return 0;
+
+    if (kind == SAMPLES_FLOAT32)
+    {
+        descriptor = ladspa_descriptor(0);
+        if (!descriptor)
+            return NO_INSTANCE;
+        instance = descriptor->instantiate(descriptor, 44100);
+        if (!instance)
+            return NO_INSTANCE;
+        descriptor->connect_port(instance, RINGER_COPY_COUNT, &copy_count);
+    }
+
+    for (channel = 0; channel < channel_count; ++channel)
+    {
+        char * in = (char *) input->buf;
+        char * out = (char *) output->buf;
+
+        if (input->ndim == 2)
+        {
+            in += channel * input->strides[0];
+            out += channel * output->strides[0];
+        }
+
+        if (kind == SAMPLES_FLOAT32
+            && ((uintptr_t) in | (uintptr_t) out) % sizeof (LADSPA_Data))
+        {
+            const size_t channel_bytes = frame_count * sizeof (LADSPA_Data);
+
+            if (!scratch)
+            {
+                scratch = (LADSPA_Data *) malloc(channel_bytes);
+                if (!scratch)
+                {
+                    descriptor->cleanup(instance);
+                    return NO_MEMORY;
+                }
+            }
+
+            memcpy(scratch, in, channel_bytes);
+            descriptor->activate(instance);
+            descriptor->connect_port(instance, RINGER_INPUT, scratch);
+            descriptor->connect_port(instance, RINGER_OUTPUT, scratch);
+            descriptor->run(instance, (unsigned long) frame_count);
+            memcpy(out, scratch, channel_bytes);
+        }
+        else if (kind == SAMPLES_FLOAT32)
+        {
+            descriptor->activate(instance);
+            descriptor->connect_port(instance, RINGER_INPUT,
+                                     (LADSPA_Data *) in);
+            descriptor->connect_port(instance, RINGER_OUTPUT,
+                                     (LADSPA_Data *) out);
+            descriptor->run(instance, (unsigned long) frame_count);
+        }
+        else
+        {
+            Ringer_pcm_state state;
+
+            ringer_pcm_reset(&state);
+            ringer_run_int16(&state, (const int16_t *) in, (int16_t *) out,
+                             (unsigned long) frame_count, copies);
+        }
+    }
+
+    free(scratch);
+    if (instance)
+        descriptor->cleanup(instance);
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+
+PyDoc_STRVAR(run_doc,
+"run(samples, copies=5, out=None)\n"
+"--\n"
+"\n"
+"Runs Ringer over 'samples' (float32 or int16, 1-D or channels x frames)\n"
+"and returns the result.  It is written back into 'samples' unless 'out'\n"
+"is given, in which case it goes into 'out', which must have the same type\n"
+"and shape, and must either be 'samples' itself or not overlap it at all.\n"
+"Each channel starts with a fresh hold, so to process a long signal in\n"
+"pieces make every piece but the last a multiple of 'copies' long.\n"
+"'copies' is clamped to 5..200 like the plugin's control.");
+
+static PyObject * ringer_run(PyObject * module, PyObject * args,
+                             PyObject * keywords)
+{
+    static char * keyword_list[] = { "samples", "copies", "out", NULL };
+    PyObject * samples;
+    PyObject * out = Py_None;
+    int copies = DEFAULT_COPIES;
+    Py_buffer input;
+    Py_buffer output;
+    int separate_output = 0;
+    int kind;
+    int result;
+
+    (void) module;
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywords, "O|iO:run", keyword_list,
+                                     &samples, &copies, &out))
+        return NULL;
+
+    // in place, the input has to be writable too
+    kind = get_samples(samples, &input, out == Py_None, "samples");
+    if (kind == SAMPLES_UNSUPPORTED)
+        return NULL;
+
+    if (out == Py_None)
+    {
+        out = samples;
+        output = input;
+    }
+    else
+    {
+        int dimension;
+
+        if (get_samples(out, &output, 1, "out") != kind)
+        {
+            if (!PyErr_Occurred())
+            {
+                PyErr_SetString(PyExc_TypeError,
+                                "out must hold the same type of samples");
+                PyBuffer_Release(&output);
+            }
+            PyBuffer_Release(&input);
+            return NULL;
+        }
+        for (dimension = 0; dimension < input.ndim; ++dimension)
+            if (output.ndim != input.ndim
+                || output.shape[dimension] != input.shape[dimension])
+            {
+                PyErr_SetString(PyExc_ValueError,
+                                "out must have the same shape as samples");
+                PyBuffer_Release(&output);
+                PyBuffer_Release(&input);
+                return NULL;
+            }
+        if (!can_write_over(&input, &output))
+        {
+            PyErr_SetString(PyExc_ValueError,
+                            "out must be samples itself or not overlap it");
+            PyBuffer_Release(&output);
+            PyBuffer_Release(&input);
+            return NULL;
+        }
+        separate_output = 1;
+    }
+
+    // the buffers stay locked (e.g. a bytearray can't be resized) until they
+    // are released, so it's safe to let go of the GIL while they are used
+    Py_BEGIN_ALLOW_THREADS
+    result = run_channels(&input, &output, kind, copies);
+    Py_END_ALLOW_THREADS
+
+    // 'out' can be 'samples' itself and still have its own buffer, so this
+    // can't just compare the objects
+    if (separate_output)
+        PyBuffer_Release(&output);
+    PyBuffer_Release(&input);
+
+    if (result == NO_MEMORY)
+        return PyErr_NoMemory();
+    if (result == NO_INSTANCE)
+    {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "could not create a Ringer instance");
+        return NULL;
+    }
+
+    Py_INCREF(out);
+    return out;
+}
+
+//-----------------------------------------------------------------------------
+
+
+static PyMethodDef ringer_methods[] =
+{
+    { "run", (PyCFunction) (void (*)(void)) ringer_run,
+      METH_VARARGS | METH_KEYWORDS, run_doc },
+    { NULL, NULL, 0, NULL }
+};
+
+
+static struct PyModuleDef ringer_module =
+{
+    PyModuleDef_HEAD_INIT,
+    "ringer",
+    "Runs the Ringer LADSPA plugin on float32 or int16 buffers, in place or "
+    "into a\ngiven output, without copying them.",
+    -1,
+    ringer_methods,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+
+PyMODINIT_FUNC PyInit_ringer()
+{
+    return PyModule_Create(&ringer_module);
+}
+
+// ------------------------------- EOF ----------------------------------------
@@ -0,0 +1,1140 @@
+/*
+ * Copyright © 2009 Tyler Hayes
+ * ALL RIGHTS RESERVED
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file COPYING in the source
+ * distribution of this software for license terms.
+ *
+ * ringer-render: runs the Ringer plugin over a whole file offline, without a
+ * LADSPA host.
+ *
+ * The input (raw 32-bit float samples, or a mono 32-bit float WAV file) and
+ * the output are both memory-mapped, and the plugin reads and writes them
+ * directly, so the samples are never copied into separate buffers (unless
+ * they aren't aligned like floats in the input, see render_chunks()).  The
+ * file is cut into chunks whose lengths are a multiple of the copy count, so
+ * every chunk starts at the beginning of a hold and the result is exactly what
+ * one run_Ringer() call over the whole file would produce.  The chunks are
+ * shared out between one thread per processor core.
+ *
+ * With -m it renders a whole list of files instead (see render_manifest()),
+ * one file per thread at a time.
+ *
+ * Usage: ringer-render [-n copies] [-j threads] [-c chunk] input output
+ *        ringer-render [-n copies] [-j threads] -m manifest
+ */
+
+
+//----------------
+//-- INCLUSIONS --
+//----------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <ladspa.h>
+
+
+//-----------------------
+//-- DEFINED CONSTANTS --
+//-----------------------
+// port numbers of the mono Ringer plugin (see sb_ringer.c)
+#define RINGER_COPY_COUNT 0
+#define RINGER_INPUT 1
+#define RINGER_OUTPUT 2
+
+// default number of copies (same as the plugin's lower bound)
+#define DEFAULT_COPIES 5
+// sample rate the plugin is told for raw files, which don't have one
+#define DEFAULT_SAMPLE_RATE 44100
+// default number of samples per chunk (rounded down to a whole number of
+// holds).  Big enough that the per-chunk overhead doesn't matter, small
+// enough that the chunks spread evenly over the threads.
+#define DEFAULT_CHUNK_SAMPLES (1024 * 1024)
+// size of the WAV header written to the output file
+#define WAV_HEADER_SIZE 44
+// WAV format tags for floating point data
+#define WAVE_FORMAT_IEEE_FLOAT 3
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+// the buffer each thread reads files into grows in steps of this many bytes
+#define BUFFER_GRANULE (64 * 1024)
+
+
+//------------
+//-- MACROS --
+//------------
+// same clamp as the plugin uses, so the chunks line up with its holds
+#define LIMIT_BETWEEN_5_AND_200(x) (((x) < 5) ? 5 : (((x) > 200) ? 200 : (x)))
+
+
+//-------------
+//-- STRUCTS --
+//-------------
+/*
+ * A memory-mapped sound file.  'data' points at the first sample inside 'map'
+ * (just past the header for WAV files).  'samples' points there too if the
+ * samples are aligned like floats, and is NULL if they aren't (see
+ * parse_wav()).
+ */
+typedef struct
+{
+    void * map;
+    size_t map_size;
+    unsigned char * data;
+    float * samples;
+    unsigned long sample_count;
+    // 1 if the file is a WAV file, 0 for raw samples
+    int is_wav;
+    unsigned long sample_rate;
+} Sound_file;
+
+
+/*
+ * Everything the worker threads share.  next_chunk is handed out with an
+ * atomic add so each chunk is processed by exactly one thread.
+ */
+typedef struct
+{
+    const LADSPA_Descriptor * descriptor;
+    // the input's samples, which may not be aligned like floats
+    const unsigned char * input;
+    int input_aligned;
+    float * output;
+    unsigned long sample_count;
+    unsigned long sample_rate;
+    unsigned long chunk_samples;
+    unsigned long chunk_count;
+    unsigned long next_chunk;
+    LADSPA_Data copy_count;
+    // set by any thread that couldn't create its plugin instance
+    int failed;
+} Render_job;
+
+
+/*
+ * One line of a manifest: a file to render, where to, and with how many
+ * copies.  'seconds' is how long it took, from opening the input to closing
+ * the output.
+ */
+typedef struct
+{
+    char * input;
+    char * output;
+    LADSPA_Data copy_count;
+    double seconds;
+    int failed;
+} Manifest_job;
+
+
+/*
+ * The jobs a thread has still to do, jobs[next] to jobs[end - 1].  The thread
+ * takes them from the front; a thread that has run out steals the back half
+ * of another thread's range.
+ */
+typedef struct
+{
+    pthread_mutex_t lock;
+    unsigned long next;
+    unsigned long end;
+} Job_range;
+
+
+/*
+ * Everything the manifest threads share, and what each one is handed.
+ */
+typedef struct
+{
+    const LADSPA_Descriptor * descriptor;
+    Manifest_job * jobs;
+    Job_range * ranges;
+    long thread_count;
+} Manifest_batch;
+
+typedef struct
+{
+    Manifest_batch * batch;
+    long index;
+} Manifest_worker;
+
+
+/*
+ * A manifest thread's plugin instance and the sample rate it was created
+ * for.  It is created again for a file with a different rate.
+ */
+typedef struct
+{
+    LADSPA_Handle handle;
+    unsigned long sample_rate;
+    LADSPA_Data copy_count;
+} Manifest_instance;
+
+
+//---------------
+//-- FUNCTIONS --
+//---------------
+
+
+/*
+ * Reads a little-endian 16 or 32 bit number out of a WAV header.
+ */
+static unsigned long read_le16(const unsigned char * bytes)
+{
+    return bytes[0] | (bytes[1] << 8);
+}
+
+static unsigned long read_le32(const unsigned char * bytes)
+{
+    return (unsigned long) bytes[0] | ((unsigned long) bytes[1] << 8)
+           | ((unsigned long) bytes[2] << 16) | ((unsigned long) bytes[3] << 24);
+}
+
+static void write_le16(unsigned char * bytes, unsigned long value)
+{
+    bytes[0] = value & 0xFF;
+    bytes[1] = (value >> 8) & 0xFF;
+}
+
+static void write_le32(unsigned char * bytes, unsigned long value)
+{
+    write_le16(bytes, value & 0xFFFF);
+    write_le16(bytes + 2, (value >> 16) & 0xFFFF);
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Finds the sample data in a memory-mapped WAV file.  Only mono 32-bit float
+ * files are accepted, since those can be handed to the plugin as they are.
+ * Returns 0 on success, -1 (after printing why) otherwise.
+ */
+static int parse_wav(Sound_file * file, const char * filename)
+{
+    unsigned char * bytes = (unsigned char *) file->map;
+    size_t offset = 12;
+    int have_format = 0;
+
+    while (offset + 8 <= file->map_size)
+    {
+        const unsigned char * chunk = bytes + offset;
+        unsigned long chunk_size = read_le32(chunk + 4);
+
+        if (!memcmp(chunk, "fmt ", 4) && chunk_size >= 16
+            && offset + 8 + 16 <= file->map_size)
+        {
+            unsigned long format = read_le16(chunk + 8);
+            unsigned long channels = read_le16(chunk + 10);
+            unsigned long bits = read_le16(chunk + 22);
+
+            // the real format of an extensible file is the first two bytes of
+            // its sub-format GUID
+            if (format == WAVE_FORMAT_EXTENSIBLE && chunk_size >= 40
+                && offset + 8 + 26 <= file->map_size)
+                format = read_le16(chunk + 32);
+
+            if (format != WAVE_FORMAT_IEEE_FLOAT || bits != 32 || channels != 1)
+            {
+                fprintf(stderr, "%s: only mono 32-bit float WAV files are "
+                        "supported\n", filename);
+                return -1;
+            }
+            file->sample_rate = read_le32(chunk + 12);
+            have_format = 1;
+        }
+        else if (!memcmp(chunk, "data", 4))
+        {
+            if (!have_format)
+                break;
+
+            // a truncated file just gets whatever samples are really there
+            if (chunk_size > file->map_size - offset - 8)
+                chunk_size = file->map_size - offset - 8;
+
+            // the plugin can only be handed the samples right where they are
+            // if they are aligned like floats.  After a chunk whose length
+            // isn't a multiple of 4 (like the 18 byte fmt chunks a lot of
+            // programs write for float files) they aren't, so then 'samples'
+            // is left NULL and they are copied somewhere aligned a chunk at
+            // a time (see render_chunks() and render_file()).  Moving them
+            // here instead would write to every page of the input mapping,
+            // which makes the kernel copy the whole file.
+            file->data = bytes + offset + 8;
+            if ((uintptr_t) file->data % sizeof (float) == 0)
+                file->samples = (float *) file->data;
+            file->sample_count = chunk_size / sizeof (float);
+            return 0;
+        }
+
+        // chunks are padded to an even number of bytes
+        offset += 8 + chunk_size + (chunk_size & 1);
+    }
+
+    fprintf(stderr, "%s: no usable fmt/data chunks in WAV file\n", filename);
+    return -1;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Works out where the samples are in a file that has been read or mapped
+ * into file->map.  Returns 0 on success, -1 (after printing why) otherwise.
+ */
+static int find_samples(Sound_file * file, const char * filename)
+{
+    if (file->map_size >= 12 && !memcmp(file->map, "RIFF", 4)
+        && !memcmp((char *) file->map + 8, "WAVE", 4))
+    {
+        file->is_wav = 1;
+        return parse_wav(file, filename);
+    }
+
+    file->data = (unsigned char *) file->map;
+    file->samples = (float *) file->map;
+    file->sample_count = file->map_size / sizeof (float);
+    return 0;
+}
+
+
+/*
+ * Writes a WAV_HEADER_SIZE byte header for a mono 32-bit float WAV file.
+ */
+static void write_wav_header(unsigned char * header, unsigned long sample_rate,
+                             size_t data_size)
+{
+    memcpy(header, "RIFF", 4);
+    write_le32(header + 4, 36 + data_size);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    write_le32(header + 16, 16);
+    write_le16(header + 20, WAVE_FORMAT_IEEE_FLOAT);
+    write_le16(header + 22, 1);
+    write_le32(header + 24, sample_rate);
+    write_le32(header + 28, sample_rate * sizeof (float));
+    write_le16(header + 32, sizeof (float));
+    write_le16(header + 34, 32);
+    memcpy(header + 36, "data", 4);
+    write_le32(header + 40, data_size);
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Memory-maps the input file (privately, so nothing is ever written back to
+ * it) and works out where its samples are.  Returns 0 on success, -1 (after
+ * printing why) otherwise.
+ */
+static int open_input(Sound_file * file, const char * filename)
+{
+    struct stat info;
+    int fd;
+
+    memset(file, 0, sizeof (Sound_file));
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0 || fstat(fd, &info) < 0)
+    {
+        perror(filename);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    if (info.st_size == 0)
+    {
+        fprintf(stderr, "%s: file is empty\n", filename);
+        close(fd);
+        return -1;
+    }
+
+    file->map_size = (size_t) info.st_size;
+    file->map = mmap(NULL, file->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file->map == MAP_FAILED)
+    {
+        perror(filename);
+        return -1;
+    }
+
+    // the whole file is read front to back, once
+    madvise(file->map, file->map_size, MADV_SEQUENTIAL);
+
+    return find_samples(file, filename);
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Creates the output file at its final size and memory-maps it for writing.
+ * If the input was a WAV file the output gets a WAV header too.  Returns 0 on
+ * success, -1 (after printing why) otherwise.
+ */
+static int open_output(Sound_file * file, const char * filename,
+                       const Sound_file * input)
+{
+    const size_t header_size = input->is_wav ? WAV_HEADER_SIZE : 0;
+    const size_t data_size = input->sample_count * sizeof (float);
+    int fd;
+
+    memset(file, 0, sizeof (Sound_file));
+
+    fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        perror(filename);
+        return -1;
+    }
+
+    file->map_size = header_size + data_size;
+    if (ftruncate(fd, (off_t) file->map_size) < 0)
+    {
+        perror(filename);
+        close(fd);
+        return -1;
+    }
+
+    file->map = mmap(NULL, file->map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fd, 0);
+    close(fd);
+    if (file->map == MAP_FAILED)
+    {
+        perror(filename);
+        return -1;
+    }
+
+    file->is_wav = input->is_wav;
+    file->sample_rate = input->sample_rate;
+    file->data = (unsigned char *) file->map + header_size;
+    file->samples = (float *) file->data;
+    file->sample_count = input->sample_count;
+
+    if (file->is_wav)
+        write_wav_header((unsigned char *) file->map, file->sample_rate,
+                         data_size);
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Worker thread.  Each thread makes its own plugin instance and keeps taking
+ * the next unprocessed chunk until there are none left.
+ *
+ * If the input's samples aren't aligned like floats (see parse_wav()), each
+ * chunk is first copied to where it goes in the output, which is always
+ * aligned, and then processed in place there.  So the bounce buffer is the
+ * output itself, and each chunk is only copied once.
+ */
+static void * render_chunks(void * argument)
+{
+    Render_job * job = (Render_job *) argument;
+    const LADSPA_Descriptor * descriptor = job->descriptor;
+    LADSPA_Handle instance;
+    unsigned long chunk;
+
+    instance = descriptor->instantiate(descriptor, job->sample_rate);
+    if (!instance)
+    {
+        __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    descriptor->connect_port(instance, RINGER_COPY_COUNT, &job->copy_count);
+
+    while ((chunk = __atomic_fetch_add(&job->next_chunk, 1, __ATOMIC_RELAXED))
+           < job->chunk_count)
+    {
+        const unsigned long start = chunk * job->chunk_samples;
+        unsigned long length = job->sample_count - start;
+
+        if (length > job->chunk_samples)
+            length = job->chunk_samples;
+
+        /*
+         * Every chunk starts at the beginning of a hold, so resetting the hold
+         * state here gives the same samples a single pass over the whole file
+         * would have.
+         *
+         * NOTE: the plugin reads from the input mapping and writes to the
+         * output mapping directly.
+         */
+        descriptor->activate(instance);
+        if (job->input_aligned)
+            descriptor->connect_port(instance, RINGER_INPUT,
+                                     (LADSPA_Data *) job->input + start);
+        else
+        {
+            memcpy(job->output + start, job->input + start * sizeof (float),
+                   length * sizeof (float));
+            descriptor->connect_port(instance, RINGER_INPUT,
+                                     job->output + start);
+        }
+        descriptor->connect_port(instance, RINGER_OUTPUT, job->output + start);
+        descriptor->run(instance, length);
+    }
+
+    descriptor->cleanup(instance);
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+
+
+static int compare_doubles(const void * a, const void * b)
+{
+    const double x = *(const double *) a;
+    const double y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+
+/*
+ * Returns the value that 'fraction' of the (sorted) values are at or below.
+ */
+static double percentile(const double * sorted, unsigned long count,
+                         double fraction)
+{
+    unsigned long index = (unsigned long) (fraction * count + 0.999999);
+
+    return sorted[index ? index - 1 : 0];
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Reads or writes all of 'size' bytes, carrying on after short reads/writes.
+ * Returns 0 on success, -1 (with errno set) otherwise.
+ */
+static int read_all(int fd, unsigned char * data, size_t size)
+{
+    while (size)
+    {
+        ssize_t count = read(fd, data, size);
+
+        if (count <= 0)
+        {
+            // a file that got shorter since fstat() counts as an error too
+            if (count == 0)
+                errno = EIO;
+            if (count == 0 || errno != EINTR)
+                return -1;
+            continue;
+        }
+        data += count;
+        size -= count;
+    }
+    return 0;
+}
+
+static int write_all(int fd, const unsigned char * data, size_t size)
+{
+    while (size)
+    {
+        ssize_t count = write(fd, data, size);
+
+        if (count < 0)
+        {
+            if (errno != EINTR)
+                return -1;
+            continue;
+        }
+        data += count;
+        size -= count;
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Makes sure a manifest thread's instance exists and was created for
+ * 'sample_rate', creating it (again) if not.  Returns 0 on success, -1 if the
+ * instance couldn't be created.
+ */
+static int prepare_instance(const LADSPA_Descriptor * descriptor,
+                            Manifest_instance * instance,
+                            unsigned long sample_rate)
+{
+    if (instance->handle && instance->sample_rate == sample_rate)
+        return 0;
+
+    if (instance->handle)
+        descriptor->cleanup(instance->handle);
+    instance->handle = descriptor->instantiate(descriptor, sample_rate);
+    if (!instance->handle)
+        return -1;
+
+    instance->sample_rate = sample_rate;
+    descriptor->connect_port(instance->handle, RINGER_COPY_COUNT,
+                             &instance->copy_count);
+    return 0;
+}
+
+
+/*
+ * Renders one manifest job with the thread's instance (created for the
+ * file's sample rate if it doesn't exist yet or was made for another one).
+ * The file is read whole into 'buffer' (which is grown if it's too small and
+ * kept for the next job, so a thread ends up allocating about once),
+ * processed in place and written out.  Returns 0 on success, -1 (after
+ * printing why) otherwise.
+ */
+static int render_file(const LADSPA_Descriptor * descriptor,
+                       Manifest_instance * instance,
+                       const Manifest_job * job, unsigned char ** buffer,
+                       size_t * buffer_size)
+{
+    unsigned char header[WAV_HEADER_SIZE];
+    Sound_file file;
+    struct stat info;
+    int fd;
+
+    memset(&file, 0, sizeof (Sound_file));
+
+    fd = open(job->input, O_RDONLY);
+    if (fd < 0 || fstat(fd, &info) < 0)
+    {
+        perror(job->input);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    if ((size_t) info.st_size > *buffer_size)
+    {
+        size_t size = ((size_t) info.st_size + BUFFER_GRANULE - 1)
+                      / BUFFER_GRANULE * BUFFER_GRANULE;
+        unsigned char * data = (unsigned char *) malloc(size);
+
+        if (!data)
+        {
+            fprintf(stderr, "%s: out of memory\n", job->input);
+            close(fd);
+            return -1;
+        }
+        free(*buffer);
+        *buffer = data;
+        *buffer_size = size;
+    }
+
+    if (read_all(fd, *buffer, (size_t) info.st_size) < 0)
+    {
+        perror(job->input);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+
+    file.map = *buffer;
+    file.map_size = (size_t) info.st_size;
+    if (find_samples(&file, job->input) < 0)
+        return -1;
+
+    // samples that aren't aligned like floats (see parse_wav()) are moved to
+    // the start of the buffer, which is ours to write to (and malloc()
+    // aligns it); the header has already been read by then
+    if (!file.samples)
+    {
+        memmove(*buffer, file.data, file.sample_count * sizeof (float));
+        file.samples = (float *) *buffer;
+    }
+
+    if (prepare_instance(descriptor, instance, file.is_wav && file.sample_rate
+                         ? file.sample_rate : DEFAULT_SAMPLE_RATE) < 0)
+    {
+        fprintf(stderr, "%s: could not create a Ringer instance\n",
+                job->input);
+        return -1;
+    }
+
+    // every file starts with a fresh hold, the same as rendering it by itself
+    if (file.sample_count)
+    {
+        instance->copy_count = job->copy_count;
+        descriptor->activate(instance->handle);
+        descriptor->connect_port(instance->handle, RINGER_INPUT,
+                                 file.samples);
+        descriptor->connect_port(instance->handle, RINGER_OUTPUT,
+                                 file.samples);
+        descriptor->run(instance->handle, file.sample_count);
+    }
+
+    fd = open(job->output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        perror(job->output);
+        return -1;
+    }
+    if (file.is_wav)
+        write_wav_header(header, file.sample_rate,
+                         file.sample_count * sizeof (float));
+    if ((file.is_wav && write_all(fd, header, WAV_HEADER_SIZE) < 0)
+        || write_all(fd, (const unsigned char *) file.samples,
+                     file.sample_count * sizeof (float)) < 0
+        || close(fd) < 0)
+    {
+        perror(job->output);
+        return -1;
+    }
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Gets the next job for thread 'index': the first one in its own range, or
+ * failing that the first of the back half of another thread's range, which
+ * then becomes its own range.  Returns 0 when there is nothing left anywhere.
+ */
+static int take_job(Manifest_batch * batch, long index, unsigned long * job)
+{
+    Job_range * own = &batch->ranges[index];
+    long i;
+
+    pthread_mutex_lock(&own->lock);
+    if (own->next < own->end)
+    {
+        *job = own->next++;
+        pthread_mutex_unlock(&own->lock);
+        return 1;
+    }
+    pthread_mutex_unlock(&own->lock);
+
+    /*
+     * Look for work starting with the next thread along, so the threads that
+     * run out don't all go after the same one.  Only one lock is held at a
+     * time, and our own range is empty (nobody steals from it) until we put
+     * the stolen jobs in it.
+     */
+    for (i = 1; i < batch->thread_count; ++i)
+    {
+        Job_range * victim = &batch->ranges[(index + i) % batch->thread_count];
+        unsigned long start, end;
+
+        pthread_mutex_lock(&victim->lock);
+        end = victim->end;
+        start = end - (end - victim->next) / 2;
+        // with one job left, take it rather than leave it
+        if (start == end && victim->next < end)
+            start = victim->next;
+        victim->end = start;
+        pthread_mutex_unlock(&victim->lock);
+
+        if (start < end)
+        {
+            pthread_mutex_lock(&own->lock);
+            own->next = start + 1;
+            own->end = end;
+            pthread_mutex_unlock(&own->lock);
+            *job = start;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ * Manifest worker thread.  It creates one plugin instance (again only if a
+ * file has a different sample rate) and one file buffer and uses them for
+ * every job it does.
+ */
+static void * render_manifest_jobs(void * argument)
+{
+    Manifest_worker * worker = (Manifest_worker *) argument;
+    Manifest_batch * batch = worker->batch;
+    const LADSPA_Descriptor * descriptor = batch->descriptor;
+    Manifest_instance instance = { NULL, 0, (LADSPA_Data) DEFAULT_COPIES };
+    unsigned char * buffer = NULL;
+    size_t buffer_size = 0;
+    unsigned long index;
+
+    while (take_job(batch, worker->index, &index))
+    {
+        Manifest_job * job = &batch->jobs[index];
+        struct timespec start, end;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        job->failed = render_file(descriptor, &instance, job, &buffer,
+                                  &buffer_size) < 0;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        job->seconds = (end.tv_sec - start.tv_sec)
+                       + (end.tv_nsec - start.tv_nsec) / 1e9;
+    }
+
+    free(buffer);
+    if (instance.handle)
+        descriptor->cleanup(instance.handle);
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Frees the first 'count' jobs read by read_manifest() and the array itself.
+ */
+static void free_manifest_jobs(Manifest_job * jobs, unsigned long count)
+{
+    unsigned long i;
+
+    for (i = 0; i < count; ++i)
+    {
+        free(jobs[i].input);
+        free(jobs[i].output);
+    }
+    free(jobs);
+}
+
+
+/*
+ * Reads a manifest: one job per line, "input output [copies]" separated by
+ * spaces or tabs (so the file names can't have spaces in them), with the
+ * copy count defaulting to 'copies'.  Blank lines and lines starting with #
+ * are skipped.  Returns the number of jobs, or -1 (after printing why).
+ */
+static long read_manifest(const char * filename, int copies,
+                          Manifest_job ** jobs)
+{
+    FILE * file = fopen(filename, "r");
+    Manifest_job * job;
+    unsigned long count = 0;
+    unsigned long room = 0;
+    unsigned long line_number = 0;
+    char line[4096];
+
+    *jobs = NULL;
+    if (!file)
+    {
+        perror(filename);
+        return -1;
+    }
+
+    while (fgets(line, sizeof (line), file))
+    {
+        char * input = strtok(line, " \t\r\n");
+        char * output = input ? strtok(NULL, " \t\r\n") : NULL;
+        char * copy_text = output ? strtok(NULL, " \t\r\n") : NULL;
+
+        ++line_number;
+        if (!input || input[0] == '#')
+            continue;
+        if (!output || (copy_text && strtok(NULL, " \t\r\n")))
+        {
+            fprintf(stderr, "%s:%lu: need 'input output [copies]'\n",
+                    filename, line_number);
+            goto fail;
+        }
+
+        if (count == room)
+        {
+            Manifest_job * more;
+
+            room = room ? room * 2 : 256;
+            more = (Manifest_job *) realloc(*jobs,
+                                            room * sizeof (Manifest_job));
+            if (!more)
+            {
+                fprintf(stderr, "out of memory\n");
+                goto fail;
+            }
+            *jobs = more;
+        }
+
+        // counted straight away, so fail: frees the names if only one was copied
+        job = &(*jobs)[count++];
+        memset(job, 0, sizeof (Manifest_job));
+        job->input = strdup(input);
+        job->output = strdup(output);
+        job->copy_count = (LADSPA_Data) (copy_text ? atof(copy_text) : copies);
+        if (!job->input || !job->output)
+        {
+            fprintf(stderr, "out of memory\n");
+            goto fail;
+        }
+    }
+
+    fclose(file);
+    return (long) count;
+
+fail:
+    fclose(file);
+    free_manifest_jobs(*jobs, count);
+    *jobs = NULL;
+    return -1;
+}
+
+
+/*
+ * Renders every job in a manifest file on 'thread_count' threads and prints
+ * how many files per second that came to, and how long the jobs took.  Each
+ * thread starts with an even share of the jobs and steals from the others
+ * when it runs out, so a few long files don't leave the other threads idle.
+ * Returns the exit status for main().
+ */
+static int render_manifest(const char * filename, int copies,
+                           long thread_count)
+{
+    Manifest_batch batch;
+    Manifest_worker * workers = NULL;
+    pthread_t * threads = NULL;
+    double * latencies = NULL;
+    struct timespec start, end;
+    double seconds;
+    unsigned long failures = 0;
+    long job_count;
+    long started;
+    long locks = 0;
+    long i;
+    int status = 1;
+
+    memset(&batch, 0, sizeof (Manifest_batch));
+    batch.descriptor = ladspa_descriptor(0);
+    if (!batch.descriptor)
+    {
+        fprintf(stderr, "could not get the Ringer plugin descriptor\n");
+        return 1;
+    }
+
+    job_count = read_manifest(filename, copies, &batch.jobs);
+    if (job_count < 0)
+        return 1;
+    if (job_count == 0)
+    {
+        fprintf(stderr, "%s: no jobs\n", filename);
+        goto done;
+    }
+
+    // no point in having more threads than jobs
+    if (thread_count > job_count)
+        thread_count = job_count;
+    batch.thread_count = thread_count;
+
+    batch.ranges = (Job_range *) calloc(thread_count, sizeof (Job_range));
+    workers = (Manifest_worker *) calloc(thread_count,
+                                         sizeof (Manifest_worker));
+    threads = (pthread_t *) calloc(thread_count, sizeof (pthread_t));
+    latencies = (double *) malloc(job_count * sizeof (double));
+    if (!batch.ranges || !workers || !threads || !latencies)
+    {
+        fprintf(stderr, "out of memory\n");
+        goto done;
+    }
+
+    for (i = 0; i < thread_count; ++i)
+    {
+        pthread_mutex_init(&batch.ranges[i].lock, NULL);
+        batch.ranges[i].next = job_count * i / thread_count;
+        batch.ranges[i].end = job_count * (i + 1) / thread_count;
+        workers[i].batch = &batch;
+        workers[i].index = i;
+    }
+    locks = thread_count;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // if a thread can't be started, the others steal its jobs
+    for (started = 0; started < thread_count; ++started)
+        if (pthread_create(&threads[started], NULL, render_manifest_jobs,
+                           &workers[started]) != 0)
+        {
+            fprintf(stderr, "could not start thread %ld\n", started);
+            break;
+        }
+    if (started == 0)
+        goto done;
+    for (i = 0; i < started; ++i)
+        pthread_join(threads[i], NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    for (i = 0; i < job_count; ++i)
+    {
+        latencies[i] = batch.jobs[i].seconds;
+        if (batch.jobs[i].failed)
+            ++failures;
+    }
+    qsort(latencies, job_count, sizeof (double), compare_doubles);
+
+    seconds = (end.tv_sec - start.tv_sec)
+              + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    fprintf(stderr, "%ld files (%lu failed), %ld threads: %.3f s, "
+            "%.1f files/sec\n"
+            "time per file: 50%% %.3f ms, 99%% %.3f ms, 99.9%% %.3f ms, "
+            "max %.3f ms\n", job_count, failures, started, seconds,
+            seconds > 0.0 ? job_count / seconds : 0.0,
+            percentile(latencies, job_count, 0.5) * 1e3,
+            percentile(latencies, job_count, 0.99) * 1e3,
+            percentile(latencies, job_count, 0.999) * 1e3,
+            latencies[job_count - 1] * 1e3);
+    status = failures ? 1 : 0;
+
+done:
+    for (i = 0; i < locks; ++i)
+        pthread_mutex_destroy(&batch.ranges[i].lock);
+    free_manifest_jobs(batch.jobs, job_count);
+    free(batch.ranges);
+    free(workers);
+    free(threads);
+    free(latencies);
+
+    return status;
+}
+
+//-----------------------------------------------------------------------------
+
+
+static void usage(const char * program)
+{
+    fprintf(stderr, "Usage: %s [-n copies] [-j threads] [-c chunk_samples] "
+            "input output\n"
+            "       %s [-n copies] [-j threads] -m manifest\n"
+            "  input is raw 32-bit float samples or a mono 32-bit float WAV "
+            "file\n"
+            "  each line of the manifest is 'input output [copies]'\n",
+            program, program);
+}
+
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char * argv[])
+{
+    int copies = DEFAULT_COPIES;
+    long thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned long chunk_samples = DEFAULT_CHUNK_SAMPLES;
+    Sound_file input;
+    Sound_file output;
+    Render_job job;
+    pthread_t * threads = NULL;
+    struct timespec start, end;
+    const char * manifest = NULL;
+    long i;
+    int option;
+    int status = 1;
+
+    while ((option = getopt(argc, argv, "n:j:c:m:h")) != -1)
+    {
+        if (option == 'n')
+            copies = atoi(optarg);
+        else if (option == 'j')
+            thread_count = atol(optarg);
+        else if (option == 'c')
+            chunk_samples = strtoul(optarg, NULL, 10);
+        else if (option == 'm')
+            manifest = optarg;
+        else
+        {
+            usage(argv[0]);
+            return option == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != (manifest ? 0 : 2))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (thread_count < 1)
+        thread_count = 1;
+
+    if (manifest)
+        return render_manifest(manifest, copies, thread_count);
+
+    // round the chunk size down to a whole number of holds (but at least one)
+    copies = LIMIT_BETWEEN_5_AND_200(copies);
+    chunk_samples -= chunk_samples % copies;
+    if (chunk_samples == 0)
+        chunk_samples = copies;
+
+    if (open_input(&input, argv[optind]) < 0)
+        return 1;
+    if (open_output(&output, argv[optind + 1], &input) < 0)
+    {
+        munmap(input.map, input.map_size);
+        return 1;
+    }
+
+    memset(&job, 0, sizeof (Render_job));
+    job.descriptor = ladspa_descriptor(0);
+    job.input = input.data;
+    job.input_aligned = input.samples != NULL;
+    job.output = output.samples;
+    job.sample_count = input.sample_count;
+    job.sample_rate = input.is_wav && input.sample_rate ? input.sample_rate
+                                                        : DEFAULT_SAMPLE_RATE;
+    job.chunk_samples = chunk_samples;
+    job.chunk_count = (input.sample_count + chunk_samples - 1) / chunk_samples;
+    job.copy_count = (LADSPA_Data) copies;
+
+    if (!job.descriptor)
+    {
+        fprintf(stderr, "could not get the Ringer plugin descriptor\n");
+        goto done;
+    }
+
+    // no point in having more threads than chunks
+    if ((unsigned long) thread_count > job.chunk_count)
+        thread_count = job.chunk_count ? (long) job.chunk_count : 1;
+
+    threads = (pthread_t *) calloc(thread_count, sizeof (pthread_t));
+    if (!threads)
+    {
+        fprintf(stderr, "out of memory\n");
+        goto done;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // if a thread can't be started, the others render its chunks
+    for (i = 0; i < thread_count; ++i)
+        if (pthread_create(&threads[i], NULL, render_chunks, &job) != 0)
+        {
+            fprintf(stderr, "could not start thread %ld\n", i);
+            thread_count = i;
+            break;
+        }
+    if (thread_count == 0)
+        job.failed = 1;
+    for (i = 0; i < thread_count; ++i)
+        pthread_join(threads[i], NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (job.failed)
+        fprintf(stderr, "rendering failed\n");
+    else
+    {
+        double seconds = (end.tv_sec - start.tv_sec)
+                         + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+        fprintf(stderr, "%lu samples, %d copies, %ld threads: %.3f s, "
+                "%.0f samples/sec\n", input.sample_count, copies,
+                thread_count, seconds,
+                seconds > 0.0 ? input.sample_count / seconds : 0.0);
+        status = 0;
+    }
+
+done:
+    free(threads);
+    munmap(input.map, input.map_size);
+    munmap(output.map, output.map_size);
+
+    return status;
+}
+
+// ------------------------------- EOF ----------------------------------------
@@ -0,0 +1,740 @@
+/*
+ * Copyright © 2009 Tyler Hayes
+ * ALL RIGHTS RESERVED
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file COPYING in the source
+ * distribution of this software for license terms.
+ *
+ * ringer-stream: runs the Ringer plugin as a pipe stage, e.g.
+ *
+ *     decoder | ringer-stream -n 40 | encoder
+ *
+ * It reads raw 32-bit float samples from stdin and writes Ringer's output to
+ * stdout.  One plugin instance is activated once and then run on every piece
+ * of input as it arrives, so the holds carry on from one read to the next and
+ * the output is exactly what one run() over the whole stream would give.
+ *
+ * There are a few buffers (2 or 3, see -d).  While one buffer is being read
+ * into and another is being written out, the one in between is being run
+ * through the plugin, so reading, processing and writing all overlap.  The
+ * reads and writes are done with io_uring, which lets the kernel do them
+ * while this program gets on with the processing.  If io_uring isn't
+ * available (a kernel older than 5.6, or it is turned off in a container)
+ * the same steps are done one at a time with plain read() and write() calls
+ * instead.
+ *
+ * No more than buffer_samples * buffers samples are ever held inside this
+ * program, which bounds the latency it adds.  A read returns as soon as any
+ * input is there (it doesn't wait for a whole buffer), so the latency is
+ * normally much lower than that.  When the input ends it prints the sustained
+ * throughput and how long each buffer took from being read to being written
+ * out (the 50th, 99th percentile and worst case) to stderr.
+ *
+ * Usage: ringer-stream [-n copies] [-b buffer_samples] [-d buffers] [-r] [-q]
+ */
+
+
+//----------------
+//-- INCLUSIONS --
+//----------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <ladspa.h>
+
+
+//-----------------------
+//-- DEFINED CONSTANTS --
+//-----------------------
+// port numbers of the mono Ringer plugin (see sb_ringer.c)
+#define RINGER_COPY_COUNT 0
+#define RINGER_INPUT 1
+#define RINGER_OUTPUT 2
+
+// default number of copies (same as the plugin's lower bound)
+#define DEFAULT_COPIES 5
+// default buffer size: 4096 samples is 85 ms at 48 kHz, and big enough that
+// the per-buffer overhead doesn't matter
+#define DEFAULT_BUFFER_SAMPLES 4096
+// double buffering only overlaps two of the three steps
+#define DEFAULT_BUFFER_COUNT 3
+#define MAX_BUFFER_COUNT 3
+// io_uring queue size (there are never more than one read and one write
+// waiting, so this is plenty)
+#define RING_ENTRIES 4
+// buffer states
+#define BUFFER_FREE 0
+#define BUFFER_READING 1
+#define BUFFER_FILLED 2
+#define BUFFER_PROCESSED 3
+#define BUFFER_WRITING 4
+// what a completed request was (stored in its user_data)
+#define REQUEST_READ 0
+#define REQUEST_WRITE 1
+
+
+//-------------
+//-- STRUCTS --
+//-------------
+/*
+ * One of the buffers.  The samples always start at the beginning of 'data';
+ * if the last read ended part way through a sample, the bytes it did get are
+ * copied to the start of the next buffer and the next read goes after them.
+ */
+typedef struct
+{
+    unsigned char * data;
+    int state;
+    // bytes read into it (including the carried over ones) and whole samples
+    size_t byte_count;
+    unsigned long sample_count;
+    // how much of the output has been written out so far
+    size_t bytes_written;
+    // when its read completed, for the latency figures
+    struct timespec read_time;
+} Stream_buffer;
+
+
+/*
+ * An io_uring instance, set up with the raw system calls (liburing isn't
+ * needed).  The pointers point into the memory the kernel shares with us.
+ */
+typedef struct
+{
+    int fd;
+    unsigned * sq_head;
+    unsigned * sq_tail;
+    unsigned * sq_mask;
+    unsigned * sq_array;
+    unsigned * cq_head;
+    unsigned * cq_tail;
+    unsigned * cq_mask;
+    struct io_uring_sqe * sqes;
+    struct io_uring_cqe * cqes;
+    void * sq_map;
+    size_t sq_map_size;
+    void * cq_map;
+    size_t cq_map_size;
+    size_t sqes_size;
+} Ring;
+
+
+/*
+ * A finished read or write: which one it was, which buffer, and the result
+ * (a byte count, or minus an errno value).
+ */
+typedef struct
+{
+    int request;
+    int buffer;
+    long result;
+} Completion;
+
+
+/*
+ * Everything the main loop keeps track of.  With 'ring' unset the requests
+ * are done straight away by plain read()/write() calls and their result is
+ * kept in 'pending' until the next wait_for_completion().
+ */
+typedef struct
+{
+    Ring * ring;
+    Completion pending[2];
+    int pending_count;
+    int reading;
+    int writing;
+} Stream_io;
+
+
+//---------------
+//-- FUNCTIONS --
+//---------------
+
+
+static double seconds_between(const struct timespec * start,
+                              const struct timespec * end)
+{
+    return (end->tv_sec - start->tv_sec)
+           + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+
+static int compare_doubles(const void * a, const void * b)
+{
+    const double x = *(const double *) a;
+    const double y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+
+/*
+ * Returns the value that 'fraction' of the (sorted) values are at or below.
+ */
+static double percentile(const double * sorted, unsigned long count,
+                         double fraction)
+{
+    unsigned long index = (unsigned long) (fraction * count + 0.999999);
+
+    return sorted[index ? index - 1 : 0];
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Asks the kernel whether its io_uring can do plain reads and writes
+ * (IORING_OP_READ and IORING_OP_WRITE).  Kernels 5.1 to 5.5 have io_uring,
+ * so setting one up works, but they only have the vectored versions and fail
+ * every read and write with EINVAL.  They don't have IORING_REGISTER_PROBE
+ * either (it came along in 5.6, with the plain reads and writes), so that
+ * failing is an answer too.
+ */
+static int ring_can_read_and_write(int ring_fd)
+{
+    const unsigned op_count = 256;
+    struct io_uring_probe * probe;
+    int supported = 0;
+
+    probe = (struct io_uring_probe *)
+            calloc(1, sizeof (struct io_uring_probe)
+                      + op_count * sizeof (struct io_uring_probe_op));
+    if (!probe)
+        return 0;
+
+    if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe,
+                op_count) == 0)
+        supported = probe->last_op >= IORING_OP_READ
+                    && probe->last_op >= IORING_OP_WRITE
+                    && (probe->ops[IORING_OP_READ].flags
+                        & IO_URING_OP_SUPPORTED)
+                    && (probe->ops[IORING_OP_WRITE].flags
+                        & IO_URING_OP_SUPPORTED);
+
+    free(probe);
+    return supported;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Sets up an io_uring.  Returns NULL (without printing anything, since the
+ * caller just falls back to read()/write()) if it can't, or if the kernel's
+ * io_uring is too old to do plain reads and writes.
+ */
+static Ring * open_ring()
+{
+    struct io_uring_params params;
+    Ring * ring;
+
+    ring = (Ring *) calloc(1, sizeof (Ring));
+    if (!ring)
+        return NULL;
+
+    memset(&params, 0, sizeof (params));
+    ring->fd = (int) syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+    if (ring->fd < 0)
+    {
+        free(ring);
+        return NULL;
+    }
+    if (!ring_can_read_and_write(ring->fd))
+    {
+        close(ring->fd);
+        free(ring);
+        return NULL;
+    }
+
+    // the submission and completion rings, and the array of submission
+    // entries, are mapped at fixed offsets of the ring's file descriptor
+    ring->sq_map_size = params.sq_off.array
+                        + params.sq_entries * sizeof (unsigned);
+    ring->cq_map_size = params.cq_off.cqes
+                        + params.cq_entries * sizeof (struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof (struct io_uring_sqe);
+
+    // newer kernels put both rings in one mapping
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cq_map_size > ring->sq_map_size)
+            ring->sq_map_size = ring->cq_map_size;
+        ring->cq_map_size = 0;
+    }
+
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd,
+                        IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED)
+    {
+        close(ring->fd);
+        free(ring);
+        return NULL;
+    }
+
+    ring->cq_map = ring->sq_map;
+    if (ring->cq_map_size)
+    {
+        ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ring->fd,
+                            IORING_OFF_CQ_RING);
+        if (ring->cq_map == MAP_FAILED)
+        {
+            munmap(ring->sq_map, ring->sq_map_size);
+            close(ring->fd);
+            free(ring);
+            return NULL;
+        }
+    }
+
+    ring->sqes = (struct io_uring_sqe *) mmap(NULL, ring->sqes_size,
+                                              PROT_READ | PROT_WRITE,
+                                              MAP_SHARED | MAP_POPULATE,
+                                              ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        if (ring->cq_map_size)
+            munmap(ring->cq_map, ring->cq_map_size);
+        munmap(ring->sq_map, ring->sq_map_size);
+        close(ring->fd);
+        free(ring);
+        return NULL;
+    }
+
+    ring->sq_head = (unsigned *) ((char *) ring->sq_map + params.sq_off.head);
+    ring->sq_tail = (unsigned *) ((char *) ring->sq_map + params.sq_off.tail);
+    ring->sq_mask = (unsigned *) ((char *) ring->sq_map
+                                  + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) ((char *) ring->sq_map + params.sq_off.array);
+    ring->cq_head = (unsigned *) ((char *) ring->cq_map + params.cq_off.head);
+    ring->cq_tail = (unsigned *) ((char *) ring->cq_map + params.cq_off.tail);
+    ring->cq_mask = (unsigned *) ((char *) ring->cq_map
+                                  + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) ((char *) ring->cq_map
+                                          + params.cq_off.cqes);
+    return ring;
+}
+
+
+static void close_ring(Ring * ring)
+{
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_map_size)
+        munmap(ring->cq_map, ring->cq_map_size);
+    munmap(ring->sq_map, ring->sq_map_size);
+    close(ring->fd);
+    free(ring);
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Starts a read (into 'buffer') or write (out of it) of 'length' bytes on
+ * 'fd'.  It gets to the kernel right away, so it runs while we process.
+ * Returns 0, or minus an errno value if the kernel wouldn't take it.
+ */
+static int ring_submit(Ring * ring, int request, int buffer, int fd,
+                       void * data, size_t length)
+{
+    const unsigned tail = *ring->sq_tail;
+    const unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe * sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof (struct io_uring_sqe));
+    sqe->opcode = request == REQUEST_READ ? IORING_OP_READ : IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long) data;
+    sqe->len = (unsigned) length;
+    // -1 means "the file's current position", which is all a pipe has
+    sqe->off = (uint64_t) -1;
+    sqe->user_data = ((uint64_t) request << 32) | (unsigned) buffer;
+    ring->sq_array[index] = index;
+
+    // the kernel must see the filled in entry before the new tail
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    while (syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0) < 0)
+        if (errno != EINTR)
+            return -errno;
+    return 0;
+}
+
+
+/*
+ * Waits for a read or write to finish and fills in 'completion'.  Returns 0,
+ * or minus an errno value if waiting failed.
+ */
+static int ring_wait(Ring * ring, Completion * completion)
+{
+    unsigned head = *ring->cq_head;
+
+    while (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+        if (syscall(__NR_io_uring_enter, ring->fd, 0, 1,
+                    IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+            return -errno;
+
+    const struct io_uring_cqe * cqe = &ring->cqes[head & *ring->cq_mask];
+    completion->request = (int) (cqe->user_data >> 32);
+    completion->buffer = (int) (cqe->user_data & 0xFFFFFFFF);
+    completion->result = cqe->res;
+
+    // hand the completion entry back to the kernel
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Starts a read or a write, with io_uring if there is one, or else does it
+ * right now with read()/write() and keeps the result for wait_for_completion().
+ */
+static void start_request(Stream_io * io, int request, int buffer, int fd,
+                          void * data, size_t length)
+{
+    if (request == REQUEST_READ)
+        io->reading = 1;
+    else
+        io->writing = 1;
+
+    if (io->ring)
+    {
+        int result = ring_submit(io->ring, request, buffer, fd, data, length);
+
+        if (result == 0)
+            return;
+
+        // report the failure the same way as a failed read or write
+        io->pending[io->pending_count].result = result;
+    }
+    else
+    {
+        long result;
+
+        while ((result = request == REQUEST_READ ? read(fd, data, length)
+                         : write(fd, data, length)) < 0 && errno == EINTR)
+            ;
+        io->pending[io->pending_count].result = result < 0 ? -errno : result;
+    }
+
+    io->pending[io->pending_count].request = request;
+    io->pending[io->pending_count].buffer = buffer;
+    ++io->pending_count;
+}
+
+
+/*
+ * Gets the next finished read or write.  Returns 0, or -1 (after printing
+ * why) if waiting for it failed.
+ */
+static int wait_for_completion(Stream_io * io, Completion * completion)
+{
+    if (io->pending_count)
+    {
+        *completion = io->pending[0];
+        io->pending[0] = io->pending[1];
+        --io->pending_count;
+    }
+    else
+    {
+        int result = ring_wait(io->ring, completion);
+
+        if (result < 0)
+        {
+            fprintf(stderr, "io_uring_enter: %s\n", strerror(-result));
+            return -1;
+        }
+    }
+
+    if (completion->request == REQUEST_READ)
+        io->reading = 0;
+    else
+        io->writing = 0;
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+
+static void usage(const char * program)
+{
+    fprintf(stderr, "Usage: %s [-n copies] [-b buffer_samples] [-d buffers] "
+            "[-r] [-q]\n"
+            "  reads raw 32-bit float samples from stdin and writes to stdout\n"
+            "  -d  2 or 3 buffers (at most buffers * buffer_samples samples "
+            "are held)\n"
+            "  -r  use plain read() and write() instead of io_uring\n"
+            "  -q  don't print the throughput and latency at the end\n",
+            program);
+}
+
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char * argv[])
+{
+    LADSPA_Data copy_count = (LADSPA_Data) DEFAULT_COPIES;
+    unsigned long buffer_samples = DEFAULT_BUFFER_SAMPLES;
+    int buffer_count = DEFAULT_BUFFER_COUNT;
+    int use_ring = 1;
+    int quiet = 0;
+    const LADSPA_Descriptor * descriptor;
+    LADSPA_Handle instance;
+    Stream_buffer buffers[MAX_BUFFER_COUNT];
+    Stream_io io;
+    // buffers are read, processed and written in turn, so these just go round
+    int next_read = 0;
+    int next_process = 0;
+    int next_write = 0;
+    // bytes of a partly read sample, to go at the start of the next buffer
+    unsigned char carry[sizeof (LADSPA_Data)];
+    size_t carry_count = 0;
+    int end_of_input = 0;
+    int failed = 0;
+    unsigned long long total_samples = 0;
+    double * latencies = NULL;
+    unsigned long latency_count = 0;
+    unsigned long latency_room = 0;
+    struct timespec start = { 0, 0 };
+    struct timespec end = { 0, 0 };
+    int started = 0;
+    int option;
+    int i;
+
+    while ((option = getopt(argc, argv, "n:b:d:rqh")) != -1)
+    {
+        if (option == 'n')
+            copy_count = (LADSPA_Data) atof(optarg);
+        else if (option == 'b')
+            buffer_samples = strtoul(optarg, NULL, 10);
+        else if (option == 'd')
+            buffer_count = atoi(optarg);
+        else if (option == 'r')
+            use_ring = 0;
+        else if (option == 'q')
+            quiet = 1;
+        else
+        {
+            usage(argv[0]);
+            return option == 'h' ? 0 : 1;
+        }
+    }
+    if (optind != argc || buffer_samples == 0 || buffer_count < 2
+        || buffer_count > MAX_BUFFER_COUNT)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    descriptor = ladspa_descriptor(0);
+    if (!descriptor)
+    {
+        fprintf(stderr, "could not get the Ringer plugin descriptor\n");
+        return 1;
+    }
+    instance = descriptor->instantiate(descriptor, 44100);
+    if (!instance)
+    {
+        fprintf(stderr, "could not create a Ringer instance\n");
+        return 1;
+    }
+    descriptor->connect_port(instance, RINGER_COPY_COUNT, &copy_count);
+    // activated once, so the hold carries on across every buffer
+    descriptor->activate(instance);
+
+    memset(buffers, 0, sizeof (buffers));
+    for (i = 0; i < buffer_count; ++i)
+    {
+        buffers[i].data = (unsigned char *)
+                aligned_alloc(64, buffer_samples * sizeof (LADSPA_Data));
+        if (!buffers[i].data)
+        {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+
+    memset(&io, 0, sizeof (io));
+    if (use_ring)
+        io.ring = open_ring();
+
+    for (;;)
+    {
+        Stream_buffer * buffer;
+        Completion completion = { 0, 0, 0 };
+
+        // keep one read going as long as there is input and a free buffer
+        buffer = &buffers[next_read];
+        if (!end_of_input && !io.reading && buffer->state == BUFFER_FREE)
+        {
+            memcpy(buffer->data, carry, carry_count);
+            buffer->byte_count = carry_count;
+            buffer->state = BUFFER_READING;
+            start_request(&io, REQUEST_READ, next_read, STDIN_FILENO,
+                          buffer->data + carry_count,
+                          buffer_samples * sizeof (LADSPA_Data) - carry_count);
+        }
+
+        // and one write, of the oldest processed buffer
+        buffer = &buffers[next_write];
+        if (!io.writing && buffer->state == BUFFER_PROCESSED)
+        {
+            buffer->state = BUFFER_WRITING;
+            start_request(&io, REQUEST_WRITE, next_write, STDOUT_FILENO,
+                          buffer->data + buffer->bytes_written,
+                          buffer->sample_count * sizeof (LADSPA_Data)
+                          - buffer->bytes_written);
+        }
+
+        /*
+         * With the read and the write under way, process a buffer that has
+         * been read (in place, since it's about to be written out anyway).
+         * Then go round again to get its write started.
+         */
+        buffer = &buffers[next_process];
+        if (buffer->state == BUFFER_FILLED && !failed)
+        {
+            if (buffer->sample_count)
+            {
+                descriptor->connect_port(instance, RINGER_INPUT,
+                                         (LADSPA_Data *) buffer->data);
+                descriptor->connect_port(instance, RINGER_OUTPUT,
+                                         (LADSPA_Data *) buffer->data);
+                descriptor->run(instance, buffer->sample_count);
+            }
+            buffer->state = BUFFER_PROCESSED;
+            next_process = (next_process + 1) % buffer_count;
+            continue;
+        }
+
+        if (!io.reading && !io.writing && !io.pending_count)
+            break;
+
+        if (wait_for_completion(&io, &completion) < 0)
+        {
+            failed = 1;
+            break;
+        }
+        buffer = &buffers[completion.buffer];
+
+        if (completion.request == REQUEST_READ)
+        {
+            if (completion.result < 0)
+            {
+                fprintf(stderr, "reading stdin: %s\n",
+                        strerror((int) -completion.result));
+                failed = 1;
+                end_of_input = 1;
+                buffer->state = BUFFER_FREE;
+                continue;
+            }
+            if (completion.result == 0)
+            {
+                end_of_input = 1;
+                buffer->state = BUFFER_FREE;
+                continue;
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &buffer->read_time);
+            if (!started)
+            {
+                start = buffer->read_time;
+                started = 1;
+            }
+
+            // only whole samples go through; the rest waits for the next read
+            buffer->byte_count += completion.result;
+            buffer->sample_count = buffer->byte_count / sizeof (LADSPA_Data);
+            carry_count = buffer->byte_count % sizeof (LADSPA_Data);
+            memcpy(carry, buffer->data + buffer->sample_count
+                   * sizeof (LADSPA_Data), carry_count);
+            buffer->bytes_written = 0;
+            buffer->state = BUFFER_FILLED;
+            next_read = (next_read + 1) % buffer_count;
+        }
+        else
+        {
+            if (completion.result < 0)
+            {
+                // e.g. the next program in the pipe has gone away
+                fprintf(stderr, "writing stdout: %s\n",
+                        strerror((int) -completion.result));
+                failed = 1;
+                end_of_input = 1;
+                buffer->state = BUFFER_FREE;
+                continue;
+            }
+
+            // a pipe can take less than all of it; the rest goes next time
+            buffer->bytes_written += completion.result;
+            if (buffer->bytes_written
+                < buffer->sample_count * sizeof (LADSPA_Data))
+            {
+                buffer->state = BUFFER_PROCESSED;
+                continue;
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            if (latency_count == latency_room)
+            {
+                latency_room = latency_room ? latency_room * 2 : 1024;
+                latencies = (double *) realloc(latencies,
+                                               latency_room * sizeof (double));
+                if (!latencies)
+                {
+                    fprintf(stderr, "out of memory\n");
+                    return 1;
+                }
+            }
+            latencies[latency_count++] = seconds_between(&buffer->read_time,
+                                                         &end);
+            total_samples += buffer->sample_count;
+            buffer->state = BUFFER_FREE;
+            next_write = (next_write + 1) % buffer_count;
+        }
+    }
+
+    if (carry_count && !failed)
+        fprintf(stderr, "warning: input ended part way through a sample; the "
+                "last %lu bytes were dropped\n", (unsigned long) carry_count);
+
+    if (!quiet && latency_count)
+    {
+        const double seconds = seconds_between(&start, &end);
+
+        qsort(latencies, latency_count, sizeof (double), compare_doubles);
+        fprintf(stderr, "%llu samples in %lu buffers (%s, %d x %lu samples): "
+                "%.3f s, %.0f samples/sec, %.1f MB/s\n"
+                "latency per buffer: 50%% %.1f us, 99%% %.1f us, "
+                "max %.1f us\n", total_samples, latency_count,
+                io.ring ? "io_uring" : "read/write", buffer_count,
+                buffer_samples, seconds,
+                seconds > 0.0 ? total_samples / seconds : 0.0,
+                seconds > 0.0 ? total_samples * sizeof (LADSPA_Data)
+                                / seconds / 1e6 : 0.0,
+                percentile(latencies, latency_count, 0.5) * 1e6,
+                percentile(latencies, latency_count, 0.99) * 1e6,
+                latencies[latency_count - 1] * 1e6);
+    }
+
+    if (io.ring)
+        close_ring(io.ring);
+    for (i = 0; i < buffer_count; ++i)
+        free(buffers[i].data);
+    free(latencies);
+    descriptor->deactivate(instance);
+    descriptor->cleanup(instance);
+
+    return failed ? 1 : 0;
+}
+
+// ------------------------------- EOF ----------------------------------------
@@ -0,0 +1,719 @@
+/*
+ * Copyright © 2009 Tyler Hayes
+ * ALL RIGHTS RESERVED
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file COPYING in the source
+ * distribution of this software for license terms.
+ *
+ * ringer-xrun: finds out how many Ringer instances this machine can run in
+ * real time.
+ *
+ * It stands in for a LADSPA host: it loads the plugin library with dlopen()
+ * (the same way a host does), creates a number of instances, and shares them
+ * out between a pool of worker threads.  A clock thread then starts a period
+ * every block_size / sample_rate seconds, just like a sound card would, and
+ * times how long the workers take to run every instance for that period.  A
+ * period that isn't finished by the time the next one is due is a deadline
+ * miss (an "xrun" -- a dropout the listener would hear).
+ *
+ * It reports the number of misses and the 50th, 99th and 99.9th percentile
+ * of the processing time.  With -m it also searches for the largest number of
+ * instances one thread (one core) can run without missing a deadline.
+ *
+ * Usage: ringer-xrun [-l library] [-d plugin] [-n instances] [-j threads]
+ *                    [-r sample_rate] [-b block_size] [-c copies]
+ *                    [-t seconds] [-x max_miss_ratio] [-B] [-m]
+ */
+
+
+//----------------
+//-- INCLUSIONS --
+//----------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <ladspa.h>
+
+
+//-----------------------
+//-- DEFINED CONSTANTS --
+//-----------------------
+// where the plugin library is loaded from by default
+#define DEFAULT_LIBRARY "./sb_ringer.so"
+#define DEFAULT_INSTANCES 256
+#define DEFAULT_SAMPLE_RATE 48000
+#define DEFAULT_BLOCK_SIZE 64
+#define DEFAULT_COPIES 16
+// how long the main test runs for, and how long each step of the -m search
+// runs for (in seconds)
+#define DEFAULT_SECONDS 5.0
+#define SEARCH_SECONDS 1.0
+// each step of the -m search is tried up to this many times before the
+// instance count is called too many (so one hiccup doesn't end the search)
+#define SEARCH_TRIES 3
+// the -m search counts a number of instances as too many when it misses more
+// than this fraction of the periods (more than it does with no instances)
+#define DEFAULT_MAX_MISS_RATIO 0.001
+// the -m search gives up at this many instances
+#define MAX_SEARCH_INSTANCES (1UL << 20)
+
+
+//-------------
+//-- STRUCTS --
+//-------------
+/*
+ * The plugin's ringer_run_batch() extension (see sb_ringer.h), looked up with
+ * dlsym() so -B works without linking to the library.
+ */
+typedef void (*Batch_function)(LADSPA_Handle * instances,
+                               unsigned long instance_count,
+                               unsigned long sample_count);
+
+
+/*
+ * The settings for one run of the test.
+ */
+typedef struct
+{
+    const LADSPA_Descriptor * descriptor;
+    unsigned long instance_count;
+    unsigned long thread_count;
+    unsigned long sample_rate;
+    unsigned long block_size;
+    LADSPA_Data copy_count;
+    double seconds;
+    // NULL to call run() on each instance
+    Batch_function run_batch;
+} Xrun_settings;
+
+
+/*
+ * Everything the worker threads share.  The clock thread and the workers
+ * meet at the 'start' barrier at the beginning of every period and at the
+ * 'finish' barrier once the workers are done with it.
+ */
+typedef struct
+{
+    const Xrun_settings * settings;
+    LADSPA_Handle * instances;
+    // one buffer for every port of every instance
+    LADSPA_Data * buffers;
+    pthread_barrier_t start;
+    pthread_barrier_t finish;
+    // set (before the start barrier) to make the workers quit
+    int stop;
+} Xrun_job;
+
+
+/*
+ * What one worker thread does: its share of the instances.
+ */
+typedef struct
+{
+    Xrun_job * job;
+    unsigned long first_instance;
+    unsigned long instance_count;
+} Xrun_worker;
+
+
+/*
+ * The results of one run of the test (times in seconds).
+ */
+typedef struct
+{
+    unsigned long periods;
+    unsigned long misses;
+    double p50;
+    double p99;
+    double p999;
+    double max;
+} Xrun_result;
+
+
+//---------------
+//-- FUNCTIONS --
+//---------------
+
+
+static double seconds_now()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+/*
+ * Sleeps until the given seconds_now() time.  Returns 0, or the error
+ * clock_nanosleep() gave if it failed for any reason other than a signal
+ * waking it up early (then it just goes back to sleep).
+ */
+static int sleep_until(double when)
+{
+    struct timespec wake;
+    int error;
+
+    wake.tv_sec = (time_t) when;
+    wake.tv_nsec = (long) ((when - wake.tv_sec) * 1e9);
+    do
+        error = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+    while (error == EINTR);
+
+    return error;
+}
+
+
+static int compare_doubles(const void * a, const void * b)
+{
+    const double x = *(const double *) a;
+    const double y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+
+/*
+ * Returns the value that 'fraction' of the (sorted) values are at or below.
+ */
+static double percentile(const double * sorted, unsigned long count,
+                         double fraction)
+{
+    unsigned long index = (unsigned long) (fraction * count + 0.999999);
+
+    return sorted[index ? index - 1 : 0];
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * The worker threads: run their instances once per period until told to
+ * stop.
+ */
+static void * work(void * argument)
+{
+    Xrun_worker * worker = (Xrun_worker *) argument;
+    Xrun_job * job = worker->job;
+    const Xrun_settings * settings = job->settings;
+    const LADSPA_Descriptor * descriptor = settings->descriptor;
+    LADSPA_Handle * instances = job->instances + worker->first_instance;
+    unsigned long i;
+
+    while (1)
+    {
+        pthread_barrier_wait(&job->start);
+        if (job->stop)
+            break;
+
+        if (settings->run_batch)
+            settings->run_batch(instances, worker->instance_count,
+                                settings->block_size);
+        else
+            for (i = 0; i < worker->instance_count; ++i)
+                descriptor->run(instances[i], settings->block_size);
+
+        pthread_barrier_wait(&job->finish);
+    }
+
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Returns the default value a control port's range hint asks for, the way the
+ * LADSPA header describes each LADSPA_HINT_DEFAULT_ value: one of the bounds,
+ * a point a quarter, half or three quarters of the way between them (on a log
+ * scale for logarithmic ports), or one of the fixed values 0, 1, 100 and 440.
+ * Bounds hinted with LADSPA_HINT_SAMPLE_RATE are multiples of 'sample_rate',
+ * and integer ports get a whole number.  Ports without a default get the
+ * lower bound, or 0 if they don't have one either.
+ */
+static LADSPA_Data default_value(const LADSPA_PortRangeHint * hint,
+                                 unsigned long sample_rate)
+{
+    const LADSPA_PortRangeHintDescriptor hints = hint->HintDescriptor;
+    const double scale = (hints & LADSPA_HINT_SAMPLE_RATE)
+            ? (double) sample_rate : 1.0;
+    const double lower = hint->LowerBound * scale;
+    const double upper = hint->UpperBound * scale;
+    // how far between the bounds the default is, for the LOW, MIDDLE and
+    // HIGH defaults
+    double position = -1.0;
+    double value = 0.0;
+
+    switch (hints & LADSPA_HINT_DEFAULT_MASK)
+    {
+        case LADSPA_HINT_DEFAULT_MINIMUM:
+            value = lower;
+            break;
+        case LADSPA_HINT_DEFAULT_LOW:
+            position = 0.25;
+            break;
+        case LADSPA_HINT_DEFAULT_MIDDLE:
+            position = 0.5;
+            break;
+        case LADSPA_HINT_DEFAULT_HIGH:
+            position = 0.75;
+            break;
+        case LADSPA_HINT_DEFAULT_MAXIMUM:
+            value = upper;
+            break;
+        case LADSPA_HINT_DEFAULT_0:
+            value = 0.0;
+            break;
+        case LADSPA_HINT_DEFAULT_1:
+            value = 1.0;
+            break;
+        case LADSPA_HINT_DEFAULT_100:
+            value = 100.0;
+            break;
+        case LADSPA_HINT_DEFAULT_440:
+            value = 440.0;
+            break;
+        default:
+            value = (hints & LADSPA_HINT_BOUNDED_BELOW) ? lower : 0.0;
+            break;
+    }
+
+    if (position >= 0.0)
+    {
+        if ((hints & LADSPA_HINT_LOGARITHMIC) && lower > 0.0 && upper > 0.0)
+            value = exp(log(lower) * (1.0 - position)
+                        + log(upper) * position);
+        else
+            value = lower * (1.0 - position) + upper * position;
+    }
+
+    if (hints & LADSPA_HINT_INTEGER)
+        value = floor(value + 0.5);
+    return (LADSPA_Data) value;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Creates the instances and connects every one of their ports to a buffer of
+ * its own: noise for the audio inputs, the copy count for the copy count port
+ * (or a whole block of it, for the audio-rate plugin), the default value for
+ * any other control inputs, and scratch space for the outputs.  Returns 0 if
+ * something couldn't be created.
+ */
+static int create_instances(Xrun_job * job)
+{
+    const Xrun_settings * settings = job->settings;
+    const LADSPA_Descriptor * descriptor = settings->descriptor;
+    const unsigned long port_count = descriptor->PortCount;
+    const unsigned long block_size = settings->block_size;
+    unsigned long instance;
+    unsigned long port;
+    unsigned long i;
+
+    job->instances = (LADSPA_Handle *) calloc(settings->instance_count,
+                                              sizeof (LADSPA_Handle));
+    job->buffers = (LADSPA_Data *) malloc(settings->instance_count * port_count
+                                          * block_size * sizeof (LADSPA_Data));
+    if (settings->instance_count && (!job->instances || !job->buffers))
+        return 0;
+
+    for (instance = 0; instance < settings->instance_count; ++instance)
+    {
+        LADSPA_Handle handle = descriptor->instantiate(descriptor,
+                                                       settings->sample_rate);
+        if (!handle)
+            return 0;
+        job->instances[instance] = handle;
+
+        for (port = 0; port < port_count; ++port)
+        {
+            const LADSPA_PortDescriptor type =
+                    descriptor->PortDescriptors[port];
+            LADSPA_Data * buffer = job->buffers
+                    + (instance * port_count + port) * block_size;
+
+            for (i = 0; i < block_size; ++i)
+            {
+                if (LADSPA_IS_PORT_INPUT(type) && port == 0)
+                    buffer[i] = settings->copy_count;
+                else if (LADSPA_IS_PORT_INPUT(type)
+                         && LADSPA_IS_PORT_CONTROL(type))
+                    buffer[i] = default_value(
+                            &descriptor->PortRangeHints[port],
+                            settings->sample_rate);
+                else if (LADSPA_IS_PORT_INPUT(type))
+                    buffer[i] = (LADSPA_Data) rand() / RAND_MAX - 0.5f;
+                else
+                    buffer[i] = 0.0f;
+            }
+
+            descriptor->connect_port(handle, port, buffer);
+        }
+
+        if (descriptor->activate)
+            descriptor->activate(handle);
+    }
+
+    return 1;
+}
+
+
+static void destroy_instances(Xrun_job * job)
+{
+    const LADSPA_Descriptor * descriptor = job->settings->descriptor;
+    unsigned long instance;
+
+    if (job->instances)
+        for (instance = 0; instance < job->settings->instance_count;
+             ++instance)
+            if (job->instances[instance])
+                descriptor->cleanup(job->instances[instance]);
+
+    free(job->instances);
+    free(job->buffers);
+    job->instances = NULL;
+    job->buffers = NULL;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Runs the test with the given settings.  Returns 0 if the instances or the
+ * threads couldn't be created.
+ */
+static int run_test(const Xrun_settings * settings, Xrun_result * result)
+{
+    const double period = (double) settings->block_size / settings->sample_rate;
+    unsigned long period_count = (unsigned long) (settings->seconds / period);
+    Xrun_job job;
+    Xrun_worker * workers;
+    pthread_t * threads;
+    double * latencies;
+    unsigned long thread;
+    unsigned long p;
+
+    if (period_count == 0)
+        period_count = 1;
+
+    memset(&job, 0, sizeof (job));
+    memset(result, 0, sizeof (*result));
+    job.settings = settings;
+
+    workers = (Xrun_worker *) calloc(settings->thread_count,
+                                     sizeof (Xrun_worker));
+    threads = (pthread_t *) calloc(settings->thread_count, sizeof (pthread_t));
+    latencies = (double *) malloc(period_count * sizeof (double));
+    if (!workers || !threads || !latencies || !create_instances(&job))
+    {
+        destroy_instances(&job);
+        free(workers);
+        free(threads);
+        free(latencies);
+        return 0;
+    }
+
+    pthread_barrier_init(&job.start, NULL, settings->thread_count + 1);
+    pthread_barrier_init(&job.finish, NULL, settings->thread_count + 1);
+
+    // split the instances up as evenly as possible
+    for (thread = 0; thread < settings->thread_count; ++thread)
+    {
+        workers[thread].job = &job;
+        workers[thread].first_instance =
+                thread * settings->instance_count / settings->thread_count;
+        workers[thread].instance_count =
+                (thread + 1) * settings->instance_count / settings->thread_count
+                - workers[thread].first_instance;
+        if (pthread_create(&threads[thread], NULL, work, &workers[thread]))
+        {
+            fprintf(stderr, "could not create thread %lu\n", thread);
+            exit(1);
+        }
+    }
+
+    /*
+     * The period clock.  Each period is started when it is due, and has to be
+     * finished by the time the next one is due.  When it isn't, the next one
+     * is started as soon as it is, the same as a host picking up after an
+     * xrun, instead of trying to catch up on the periods that were missed.
+     */
+    double due = seconds_now() + period;
+
+    for (p = 0; p < period_count; ++p)
+    {
+        const int error = sleep_until(due);
+
+        if (error)
+        {
+            fprintf(stderr, "could not wait for the next period: %s\n",
+                    strerror(error));
+            exit(1);
+        }
+
+        const double start = seconds_now();
+        pthread_barrier_wait(&job.start);
+        pthread_barrier_wait(&job.finish);
+        const double end = seconds_now();
+
+        latencies[p] = end - start;
+        due += period;
+        if (end > due)
+        {
+            ++result->misses;
+            due = end;
+        }
+    }
+
+    job.stop = 1;
+    pthread_barrier_wait(&job.start);
+    for (thread = 0; thread < settings->thread_count; ++thread)
+        pthread_join(threads[thread], NULL);
+
+    pthread_barrier_destroy(&job.start);
+    pthread_barrier_destroy(&job.finish);
+    destroy_instances(&job);
+
+    qsort(latencies, period_count, sizeof (double), compare_doubles);
+    result->periods = period_count;
+    result->p50 = percentile(latencies, period_count, 0.5);
+    result->p99 = percentile(latencies, period_count, 0.99);
+    result->p999 = percentile(latencies, period_count, 0.999);
+    result->max = latencies[period_count - 1];
+
+    free(workers);
+    free(threads);
+    free(latencies);
+    return 1;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Returns 1 if 'instance_count' instances can be run with 'settings' with no
+ * more than 'max_miss_ratio' of the periods missed, in any of SEARCH_TRIES
+ * tries.
+ */
+static int is_sustainable(Xrun_settings * settings,
+                          unsigned long instance_count, double max_miss_ratio)
+{
+    Xrun_result result;
+    int tries;
+
+    settings->instance_count = instance_count;
+    for (tries = 0; tries < SEARCH_TRIES; ++tries)
+    {
+        if (!run_test(settings, &result))
+            return 0;
+        if (result.misses <= max_miss_ratio * result.periods)
+            return 1;
+    }
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Finds the largest number of instances one thread can run with no more than
+ * 'max_miss_ratio' more of the periods missed than with no instances at all:
+ * doubles the count until it fails, then narrows it down.  Returns 0 if even
+ * one instance is too many.
+ *
+ * NOTE: the periods missed with no instances are the ones the clock thread
+ * itself didn't wake up in time for.  On a desktop that doesn't run it with
+ * real-time priority (or in a virtual machine) there can be a few of those,
+ * which have nothing to do with the plugin.
+ */
+static unsigned long find_max_instances(const Xrun_settings * settings,
+                                        double max_miss_ratio)
+{
+    Xrun_settings search = *settings;
+    Xrun_result result;
+    unsigned long good = 0;
+    unsigned long bad = 1;
+
+    search.thread_count = 1;
+    search.seconds = SEARCH_SECONDS;
+
+    search.instance_count = 0;
+    if (run_test(&search, &result))
+    {
+        printf("deadline misses with no instances: %lu (%.3f%%)\n",
+               result.misses, 100.0 * result.misses / result.periods);
+        max_miss_ratio += (double) result.misses / result.periods;
+    }
+
+    // find a count that's too many
+    while (bad <= MAX_SEARCH_INSTANCES
+           && is_sustainable(&search, bad, max_miss_ratio))
+    {
+        good = bad;
+        bad *= 2;
+    }
+
+    // and then the largest one that isn't
+    while (bad - good > 1)
+    {
+        const unsigned long middle = good + (bad - good) / 2;
+
+        if (is_sustainable(&search, middle, max_miss_ratio))
+            good = middle;
+        else
+            bad = middle;
+    }
+
+    return good;
+}
+
+//-----------------------------------------------------------------------------
+
+
+static void usage(const char * program)
+{
+    fprintf(stderr, "Usage: %s [-l library] [-d plugin] [-n instances] "
+            "[-j threads]\n"
+            "       [-r sample_rate] [-b block_size] [-c copies] "
+            "[-t seconds]\n"
+            "       [-x max_miss_ratio] [-B] [-m]\n", program);
+}
+
+
+int main(int argc, char * argv[])
+{
+    const char * library = DEFAULT_LIBRARY;
+    unsigned long plugin = 0;
+    double max_miss_ratio = DEFAULT_MAX_MISS_RATIO;
+    int search = 0;
+    int batched = 0;
+    Xrun_settings settings;
+    Xrun_result result;
+    LADSPA_Descriptor_Function get_descriptor;
+    void * handle;
+    int option;
+
+    settings.descriptor = NULL;
+    settings.instance_count = DEFAULT_INSTANCES;
+    settings.thread_count = (unsigned long) sysconf(_SC_NPROCESSORS_ONLN);
+    settings.sample_rate = DEFAULT_SAMPLE_RATE;
+    settings.block_size = DEFAULT_BLOCK_SIZE;
+    settings.copy_count = DEFAULT_COPIES;
+    settings.seconds = DEFAULT_SECONDS;
+    settings.run_batch = NULL;
+
+    while ((option = getopt(argc, argv, "l:d:n:j:r:b:c:t:x:Bmh")) != -1)
+    {
+        switch (option)
+        {
+        case 'l':
+            library = optarg;
+            break;
+        case 'd':
+            plugin = strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            settings.instance_count = strtoul(optarg, NULL, 10);
+            break;
+        case 'j':
+            settings.thread_count = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            settings.sample_rate = strtoul(optarg, NULL, 10);
+            break;
+        case 'b':
+            settings.block_size = strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            settings.copy_count = (LADSPA_Data) atof(optarg);
+            break;
+        case 't':
+            settings.seconds = atof(optarg);
+            break;
+        case 'x':
+            max_miss_ratio = atof(optarg);
+            break;
+        case 'B':
+            batched = 1;
+            break;
+        case 'm':
+            search = 1;
+            break;
+        default:
+            usage(argv[0]);
+            return option == 'h' ? 0 : 1;
+        }
+    }
+
+    if (optind != argc || settings.thread_count < 1
+        || settings.instance_count < settings.thread_count
+        || settings.sample_rate == 0 || settings.block_size == 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // load the plugin the way a host would
+    handle = dlopen(library, RTLD_NOW | RTLD_LOCAL);
+    if (!handle)
+    {
+        fprintf(stderr, "could not load %s: %s\n", library, dlerror());
+        return 1;
+    }
+    get_descriptor = (LADSPA_Descriptor_Function) dlsym(handle,
+                                                        "ladspa_descriptor");
+    settings.descriptor = get_descriptor ? get_descriptor(plugin) : NULL;
+    if (!settings.descriptor)
+    {
+        fprintf(stderr, "%s has no plugin number %lu\n", library, plugin);
+        return 1;
+    }
+    if (batched)
+    {
+        settings.run_batch = (Batch_function) dlsym(handle,
+                                                    "ringer_run_batch");
+        if (!settings.run_batch)
+        {
+            fprintf(stderr, "%s has no ringer_run_batch()\n", library);
+            return 1;
+        }
+    }
+
+    const double period = (double) settings.block_size / settings.sample_rate;
+
+    printf("%s: %lu instances on %lu threads, %lu samples at %lu Hz "
+           "(%.1f us periods)%s\n", settings.descriptor->Label,
+           settings.instance_count, settings.thread_count, settings.block_size,
+           settings.sample_rate, period * 1e6,
+           settings.run_batch ? ", batched" : "");
+
+    if (!run_test(&settings, &result))
+    {
+        fprintf(stderr, "could not create the plugin instances\n");
+        return 1;
+    }
+
+    printf("periods: %lu, deadline misses: %lu (%.3f%%)\n", result.periods,
+           result.misses, 100.0 * result.misses / result.periods);
+    printf("processing time (us): p50 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n",
+           result.p50 * 1e6, result.p99 * 1e6, result.p999 * 1e6,
+           result.max * 1e6);
+
+    if (search)
+        printf("max instances per core: %lu\n",
+               find_max_instances(&settings, max_miss_ratio));
+
+    dlclose(handle);
+    return 0;
+}
+
+// ------------------------------- EOF ----------------------------------------
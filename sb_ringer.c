@@ -11,6 +11,13 @@
  * The number of copies to be made is controlled by the user.  The range
  * is 5 to 200 samples.
  *
+ * The plugin can be run in place (with the same buffer connected to an input
+ * port and an output port).  Each held sample is read from the input before
+ * any of its copies are written, and a hold never writes past the sample
+ * where the next one starts, so nothing is overwritten before it is read.
+ * unit_test_for_ringer.c checks that running in place gives exactly the same
+ * output as separate buffers.
+ *
  * Thanks to:
  * - Bart Massey of Portland State University (http://web.cecs.pdx.edu/~bart/)
  *   for suggesting LADSPA plugins as a project.
@@ -23,33 +30,124 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
 #include <ladspa.h>
+#include "sb_ringer.h"
+
+// USDT probes (for tracing with bpftrace, perf, etc.) are only compiled in when
+// RINGER_USDT is defined (the Makefile does this when sys/sdt.h is installed)
+#ifdef RINGER_USDT
+#include <sys/sdt.h>
+#endif
+
+// the vectorized fill kernels are only built for x86 processors; everything
+// else uses the plain C loop
+#if defined(__x86_64__) || defined(__i386__)
+#define RINGER_X86
+#include <x86intrin.h>
+#endif
 
 
 //-----------------------
 //-- DEFINED CONSTANTS --
 //-----------------------
 /*
- * These are the port numbers for the plugin
+ * These are the port numbers for the plugin.
+ *
+ * NOTE: the multichannel plugins have one input port per channel starting at
+ * RINGER_INPUT, followed by one output port per channel.  RINGER_OUTPUT is
+ * only the output port of the mono plugin (use the OUTPUT_PORT macro below for
+ * the others).
  */
 // control port for the number of sample copies to be made
 #define RINGER_COPY_COUNT 0
-// input port
+// input port (of the first channel)
 #define RINGER_INPUT 1
-// output port
+// output port (mono plugin)
 #define RINGER_OUTPUT 2
+// DSP load output control ports (mono plugin with RINGER_LOAD_PORTS)
+#define RINGER_LOAD 3
+#define RINGER_PEAK_LOAD 4
+// bit depth and gain input control ports (mono plugin with RINGER_CRUSH_PORTS)
+#define RINGER_BITS 3
+#define RINGER_GAIN 4
+// band-limiting on/off input control port (mono plugin with
+// RINGER_BAND_LIMITED)
+#define RINGER_MODE 3
 
 /*
  * Other constants
  */
 // the plugin's unique ID given by Richard Furse (ladspa@muse.demon.co.uk)
 #define UNIQUE_ID 4303
-// number of ports involved
+// number of ports involved (mono plugin)
 #define PORT_COUNT 3
+// maximum number of audio channels a single plugin instance processes
+#define MAX_CHANNELS 8
+// number of plugins (descriptors) in this library: mono, stereo, quad, 5.1,
+// 8 channel, audio-rate copy count, DSP load, bitcrushed, fractional copy
+// count and band-limited
+#define DESCRIPTOR_COUNT 10
 // maximum number of samples to copy
 #define MAX_COPIES 200
 // minimum number of samples to copy
 #define MIN_COPIES 5
+// range of the bitcrushed plugin's bit depth and gain (in dB) controls
+#define MIN_BITS 1
+#define MAX_BITS 24
+#define MIN_GAIN_DB -60
+#define MAX_GAIN_DB 24
+
+/*
+ * Flags for the plugins that work a little differently from the original
+ * (see Ringer_variant below)
+ */
+// the copy count port is an audio port instead of a control port
+#define RINGER_AUDIO_RATE_COPIES 0x1
+// the plugin has output control ports reporting its DSP load
+#define RINGER_LOAD_PORTS 0x2
+// the plugin reduces the bit depth of (and applies a gain to) what it holds
+#define RINGER_CRUSH_PORTS 0x4
+// the copy count doesn't have to be a whole number
+#define RINGER_FRACTIONAL_COPIES 0x8
+// the steps between holds can be smoothed out (see BAND-LIMITED STEPS below)
+#define RINGER_BAND_LIMITED 0x10
+
+// number of bits after the point in the fractional plugin's fixed-point hold
+// lengths (16.16 fixed point)
+#define HOLD_FRACTION_BITS 16
+
+// the band-limited plugin's step: zero crossings on each side of the sinc it
+// is made from, points per hold length in the table it is worked out in, and
+// the size of the FFTs used for that (only done once, in _init())
+#define BLEP_ZERO_CROSSINGS 4
+#define BLEP_OVERSAMPLING 64
+#define BLEP_FFT_SIZE 4096
+// a step is spread over this many hold lengths, and holds longer than
+// BLEP_MAX_STRETCH samples get the step made for that length (so no step is
+// longer than BLEP_MAX_LENGTH samples)
+#define BLEP_SPAN (2 * BLEP_ZERO_CROSSINGS)
+#define BLEP_MAX_STRETCH 16
+#define BLEP_MAX_LENGTH (BLEP_SPAN * BLEP_MAX_STRETCH)
+
+// number of diagnostic events kept for ringer_read_events() (must be a power
+// of 2)
+#define EVENT_RING_SIZE 256
+// number of samples (shared between all the channels) staged in the cache
+// before being streamed out
+#define STREAM_TILE 1024
+// how long the first DSP load plugin's instantiate() spends working out how
+// fast the processor's clock ticks (in nanoseconds)
+#define CLOCK_CALIBRATION_TIME 1000000
+// size of a cache line (instances are aligned to it), and the number of
+// instances in each slab of the instance pool
+#define CACHE_LINE_SIZE 64
+#define INSTANCE_SLAB_SIZE 64
+// ringer_run_batch() sorts instances into groups this many at a time
+#define BATCH_WINDOW 64
 
 
 //------------
@@ -61,6 +159,30 @@
  */
 #define LIMIT_BETWEEN_5_AND_200(x) (((x) < 5) ? 5 : (((x) > 200) ? 200 : (x)))
 
+/*
+ * Port number of the output port for a given channel of a plugin with a given
+ * number of channels.
+ */
+#define OUTPUT_PORT(channel, channel_count) \
+        (RINGER_INPUT + (channel_count) + (channel))
+
+/*
+ * Tracepoints.  With RINGER_USDT defined these are USDT probes in the
+ * "ringer" provider, which are a single NOP in the code until a tracer
+ * attaches to them, e.g.:
+ *
+ *   bpftrace -e 'usdt:./sb_ringer.so:ringer:run_exit { @[arg0] = count(); }'
+ *
+ * Without it they compile to nothing at all.
+ */
+#ifdef RINGER_USDT
+#define RINGER_PROBE1(name, a) DTRACE_PROBE1(ringer, name, a)
+#define RINGER_PROBE3(name, a, b, c) DTRACE_PROBE3(ringer, name, a, b, c)
+#else
+#define RINGER_PROBE1(name, a) do { } while (0)
+#define RINGER_PROBE3(name, a, b, c) do { } while (0)
+#endif
+
 
 //-------------------------
 //-- FUNCTION PROTOTYPES --
@@ -69,420 +191,3138 @@
 // none
 
 
-//--------------------------------
-//-- STRUCT FOR PORT CONNECTION --
-//--------------------------------
+//------------------
+//-- FILL KERNELS --
+//------------------
+/*
+ * A fill kernel writes the same sample value into 'count' consecutive
+ * locations of an output buffer.  This is where run() spends nearly all of its
+ * time, so there is a plain C version that works everywhere and vectorized
+ * versions for x86 processors that support them.  The best one for the
+ * processor the host is running on is picked once in _init() and stored in
+ * fill_samples.
+ *
+ * NOTE: every kernel only ever stores the value it was handed (there is no
+ * arithmetic involved), so they all produce bit-identical output.  The vector
+ * kernels assume LADSPA_Data is a 4-byte float, which it is in ladspa.h.
+ */
+typedef void (*Ringer_fill_function)(LADSPA_Data * output, LADSPA_Data value,
+                                     unsigned long count);
 
 
-typedef struct
+/*
+ * The plain C kernel.  This is the fallback for processors that don't have
+ * any of the vector instruction sets below.
+ */
+static void fill_scalar(LADSPA_Data * output, LADSPA_Data value,
+                        unsigned long count)
 {
-    // the number of copies to be placed into the output buffer.
-    // NOTE: the number has to be an integer between 5 and 200, but this
-    // variable is a pointer to a LADSPA_Data (a float), because the connection
-    // to data_location in the connect_port() function cannot be made unless
-    // they are of the same type.
-    LADSPA_Data * copy_count;
-    // data locations for the input & output audio ports
-    LADSPA_Data * Input;
-    LADSPA_Data * Output;
-} Ringer;
-
+    unsigned long i;
 
-//---------------
-//-- FUNCTIONS --
-//---------------
+    for (i = 0; i < count; ++i)
+        output[i] = value;
+}
 
+#ifdef RINGER_X86
 
 /*
- * Creates a plugin instance by allocating space for a plugin handle.
- * This function returns a LADSPA_Handle (which is a void * -- a pointer to
- * anything).
+ * SSE2 kernel (4 samples per store).  For 4 or more samples, the unaligned
+ * head and tail are each covered by a single unaligned store that overlaps the
+ * aligned stores in the middle, which is harmless since every store writes the
+ * same value.
  */
-LADSPA_Handle instantiate_Ringer()
+__attribute__((target("sse2")))
+static void fill_sse2(LADSPA_Data * output, LADSPA_Data value,
+                      unsigned long count)
 {
-    Ringer * ringer;
+    if (count < 4)
+    {
+        fill_scalar(output, value, count);
+        return;
+    }
 
-    // allocate space for an Ringer struct instance
-    ringer = (Ringer *) malloc(sizeof (Ringer));
+    const __m128 broadcast = _mm_set1_ps(value);
+    LADSPA_Data * end = output + count;
+    // first 16-byte boundary after the start of the buffer
+    LADSPA_Data * aligned = (LADSPA_Data *)
+            (((uintptr_t) output + 16) & ~(uintptr_t) 15);
 
-    // send the LADSPA_Handle to the host.  If malloc failed, NULL is returned.
-    return ringer;
+    _mm_storeu_ps(output, broadcast);
+    while (aligned + 4 <= end)
+    {
+        _mm_store_ps(aligned, broadcast);
+        aligned += 4;
+    }
+    _mm_storeu_ps(end - 4, broadcast);
 }
 
-//-----------------------------------------------------------------------------
+/*
+ * AVX2 kernel (8 samples per store).  Same head/tail trick as the SSE2 one.
+ */
+__attribute__((target("avx2")))
+static void fill_avx2(LADSPA_Data * output, LADSPA_Data value,
+                      unsigned long count)
+{
+    if (count < 8)
+    {
+        fill_sse2(output, value, count);
+        return;
+    }
 
+    const __m256 broadcast = _mm256_set1_ps(value);
+    LADSPA_Data * end = output + count;
+    // first 32-byte boundary after the start of the buffer
+    LADSPA_Data * aligned = (LADSPA_Data *)
+            (((uintptr_t) output + 32) & ~(uintptr_t) 31);
+
+    _mm256_storeu_ps(output, broadcast);
+    while (aligned + 8 <= end)
+    {
+        _mm256_store_ps(aligned, broadcast);
+        aligned += 8;
+    }
+    _mm256_storeu_ps(end - 8, broadcast);
+}
 
 /*
- * Make a connection between a specified port and it's corresponding data
- * location. For example, the output port should be "connected" to the place in
- * memory where that sound data to be played is located.
+ * AVX-512 kernel (16 samples per store).  AVX-512 has masked stores, so the
+ * head and tail are written with a single store each that only touches the
+ * samples inside the buffer (masked-off lanes are never written, even when
+ * they would fall outside the buffer).
  */
-void connect_port_to_Ringer(LADSPA_Handle instance, unsigned long Port,
-                            LADSPA_Data * data_location)
+__attribute__((target("avx512f")))
+static void fill_avx512(LADSPA_Data * output, LADSPA_Data value,
+                        unsigned long count)
 {
-    Ringer * ringer;
+    const __m512 broadcast = _mm512_set1_ps(value);
+    // number of samples before the first 64-byte boundary
+    unsigned long head = ((64 - ((uintptr_t) output & 63)) & 63)
+            / sizeof (LADSPA_Data);
+
+    if (head > count)
+        head = count;
+    if (head)
+    {
+        _mm512_mask_storeu_ps(output, (__mmask16) ((1u << head) - 1),
+                              broadcast);
+        output += head;
+        count -= head;
+    }
+    while (count >= 16)
+    {
+        _mm512_store_ps(output, broadcast);
+        output += 16;
+        count -= 16;
+    }
+    if (count)
+        _mm512_mask_storeu_ps(output, (__mmask16) ((1u << count) - 1),
+                              broadcast);
+}
 
-    // cast the (void *) instance to (Ringer *) and set it to local pointer
-    ringer = (Ringer *) instance;
+#endif // RINGER_X86
 
-    // direct the appropriate data pointer to the appropriate data location
-    if (Port == RINGER_COPY_COUNT)
-        ringer->copy_count = data_location;
-    else if (Port == RINGER_INPUT)
-        ringer->Input = data_location;
-    else if (Port == RINGER_OUTPUT)
-        ringer->Output = data_location;
+
+/*
+ * The adding kernels used by run_adding().  Instead of overwriting the output
+ * buffer, these add the value to what is already there.  The value handed in
+ * already has the run_adding gain applied, so each output sample gets exactly
+ * one addition no matter which kernel does it, which keeps them all
+ * bit-identical too.
+ *
+ * NOTE: unlike the fill kernels, the head and tail can't be covered by
+ * overlapping stores (a sample would get the value added twice), so they are
+ * done one sample at a time (or with masked loads/stores for AVX-512).
+ */
+static void add_scalar(LADSPA_Data * output, LADSPA_Data value,
+                       unsigned long count)
+{
+    unsigned long i;
+
+    for (i = 0; i < count; ++i)
+        output[i] += value;
 }
 
-//-----------------------------------------------------------------------------
+#ifdef RINGER_X86
+
+/*
+ * SSE2 adding kernel (4 samples per load/store).
+ */
+__attribute__((target("sse2")))
+static void add_sse2(LADSPA_Data * output, LADSPA_Data value,
+                     unsigned long count)
+{
+    const __m128 broadcast = _mm_set1_ps(value);
 
+    // one sample at a time until the buffer is 16-byte aligned
+    while (count && ((uintptr_t) output & 15))
+    {
+        *output++ += value;
+        --count;
+    }
+    while (count >= 4)
+    {
+        _mm_store_ps(output, _mm_add_ps(_mm_load_ps(output), broadcast));
+        output += 4;
+        count -= 4;
+    }
+    add_scalar(output, value, count);
+}
 
 /*
- * Here is where the rubber hits the road.  The actual sound manipulation
- * is done in run().
+ * AVX2 adding kernel (8 samples per load/store).
  */
-void run_Ringer(LADSPA_Handle instance, unsigned long sample_count)
+__attribute__((target("avx2")))
+static void add_avx2(LADSPA_Data * output, LADSPA_Data value,
+                     unsigned long count)
 {
-    Ringer * ringer = (Ringer *) instance;
+    const __m256 broadcast = _mm256_set1_ps(value);
 
-    /*
-     * NOTE: these special cases should never happen, but you never know--like
-     * if someone is developing a host program and it has some bugs in it, it
-     * might pass some bad data.
-     */
-    if (sample_count <= 1)
+    // one sample at a time until the buffer is 32-byte aligned
+    while (count && ((uintptr_t) output & 31))
     {
-        printf("\nEither 0 or 1 sample(s) were passed into the plugin.");
-        printf("\nPlugin not executed.\n");
-        return;
+        *output++ += value;
+        --count;
     }
-    if (!ringer)
+    while (count >= 8)
     {
-        printf("\nPlugin received NULL pointer for plugin instance.");
-        printf("\nPlugin not executed.\n");
-        return;
+        _mm256_store_ps(output,
+                        _mm256_add_ps(_mm256_load_ps(output), broadcast));
+        output += 8;
+        count -= 8;
     }
+    add_scalar(output, value, count);
+}
 
-    LADSPA_Data * input; // to point to the input stream
-    LADSPA_Data * output; // to point to the output stream
+/*
+ * AVX-512 adding kernel (16 samples per load/store, masked head and tail).
+ */
+__attribute__((target("avx512f")))
+static void add_avx512(LADSPA_Data * output, LADSPA_Data value,
+                       unsigned long count)
+{
+    const __m512 broadcast = _mm512_set1_ps(value);
+    // number of samples before the first 64-byte boundary
+    unsigned long head = ((64 - ((uintptr_t) output & 63)) & 63)
+            / sizeof (LADSPA_Data);
+    __mmask16 mask;
+
+    if (head > count)
+        head = count;
+    if (head)
+    {
+        mask = (__mmask16) ((1u << head) - 1);
+        _mm512_mask_storeu_ps(output, mask, _mm512_add_ps(
+                _mm512_maskz_loadu_ps(mask, output), broadcast));
+        output += head;
+        count -= head;
+    }
+    while (count >= 16)
+    {
+        _mm512_store_ps(output,
+                        _mm512_add_ps(_mm512_load_ps(output), broadcast));
+        output += 16;
+        count -= 16;
+    }
+    if (count)
+    {
+        mask = (__mmask16) ((1u << count) - 1);
+        _mm512_mask_storeu_ps(output, mask, _mm512_add_ps(
+                _mm512_maskz_loadu_ps(mask, output), broadcast));
+    }
+}
 
-    // link the local pointers to their appropriate streams passed in through
-    // instance
-    input = ringer->Input;
-    output = ringer->Output;
+#endif // RINGER_X86
 
-    // indexes for the input and output buffers
-    unsigned long in_index = 0;
-    unsigned long out_index = 0;
 
-    // set the number of copies to be made using the defined macro
-    const int SAMPLE_COPY_COUNT =
-            LIMIT_BETWEEN_5_AND_200((int) *(ringer->copy_count));
+/*
+ * The streaming kernels copy samples to the output buffer with non-temporal
+ * stores, which go straight to memory instead of through the cache.  They are
+ * used for huge blocks (see stream_block() below), where the output would
+ * otherwise push everything else out of the cache, including the data of
+ * whatever other plugins are running.  Non-temporal stores can only be done
+ * on aligned vectors, so the unaligned head and tail of the buffer are
+ * written with normal stores.  stream_fence() has to be called after the last
+ * one so the samples are visible to other threads before run() returns.
+ */
+typedef void (*Ringer_stream_function)(LADSPA_Data * output,
+                                       const LADSPA_Data * source,
+                                       unsigned long count);
 
-    // go through the input buffer and make the necessary copies into the
-    // output buffer
-    while (in_index < sample_count)
-    {
-        // make the first copy (there will always be at least 2 samples due to
-        // the first condition of this function)
-        output[out_index++] = input[in_index];
 
-        /*
-         * Copy the current sample in the input buffer to the rest of the output
-         * buffer if the input buffer index is anywhere between the set number
-         * of copies being made until the end of the input buffer.
-         *
-         * NOTE: the ...0xFFFFFFFFFFFFFFFF... condition is for when the sample
-         * count is less than the set number of copies being made.  If this were
-         * not here, an underflow will occur since sample_count is an unsigned
-         * integer, making it a huge positive number, which of course, in_index
-         * will never be greater than or equal to.
-         */
-        if (in_index >= sample_count - (SAMPLE_COPY_COUNT - 1)
-            || (sample_count - (SAMPLE_COPY_COUNT - 1))
-               >= 0xFFFFFFFFFFFFFFFF - (SAMPLE_COPY_COUNT - 1))
-        {
-            while (out_index < sample_count)
-                output[out_index++] = input[in_index];
+/*
+ * The plain C version.  Without vector instructions there's no non-temporal
+ * store, so this is just a copy.
+ */
+static void stream_scalar(LADSPA_Data * output, const LADSPA_Data * source,
+                          unsigned long count)
+{
+    memcpy(output, source, count * sizeof (LADSPA_Data));
+}
 
-            // get out of the loop since the output buffer is now full
-            break;
-        }
+#ifdef RINGER_X86
 
-        // since in_index is not between the number of copies to the end of the
-        // input buffer at this point, make the necessary copies to the output
-        // buffer
-        while (out_index < in_index + SAMPLE_COPY_COUNT)
-            output[out_index++] = input[in_index];
+__attribute__((target("sse2")))
+static void stream_sse2(LADSPA_Data * output, const LADSPA_Data * source,
+                        unsigned long count)
+{
+    // normal stores until the output is 16-byte aligned
+    while (count && ((uintptr_t) output & 15))
+    {
+        *output++ = *source++;
+        --count;
+    }
+    while (count >= 4)
+    {
+        _mm_stream_ps(output, _mm_loadu_ps(source));
+        output += 4;
+        source += 4;
+        count -= 4;
+    }
+    stream_scalar(output, source, count);
+}
 
-        // jump ahead in the input buffer by the number of set copies to be made
-        in_index += SAMPLE_COPY_COUNT;
+__attribute__((target("avx2")))
+static void stream_avx2(LADSPA_Data * output, const LADSPA_Data * source,
+                        unsigned long count)
+{
+    // normal stores until the output is 32-byte aligned
+    while (count && ((uintptr_t) output & 31))
+    {
+        *output++ = *source++;
+        --count;
+    }
+    while (count >= 8)
+    {
+        _mm256_stream_ps(output, _mm256_loadu_ps(source));
+        output += 8;
+        source += 8;
+        count -= 8;
+    }
+    stream_scalar(output, source, count);
+}
 
-        // get out of the loop if in_index is now beyond the end of the input
-        // buffer
-        if (in_index >= sample_count)
-            break;
+__attribute__((target("avx512f")))
+static void stream_avx512(LADSPA_Data * output, const LADSPA_Data * source,
+                          unsigned long count)
+{
+    // number of samples before the first 64-byte boundary (written with a
+    // normal masked store)
+    unsigned long head = ((64 - ((uintptr_t) output & 63)) & 63)
+            / sizeof (LADSPA_Data);
+    __mmask16 mask;
+
+    if (head > count)
+        head = count;
+    if (head)
+    {
+        mask = (__mmask16) ((1u << head) - 1);
+        _mm512_mask_storeu_ps(output, mask,
+                              _mm512_maskz_loadu_ps(mask, source));
+        output += head;
+        source += head;
+        count -= head;
+    }
+    while (count >= 16)
+    {
+        _mm512_stream_ps(output, _mm512_loadu_ps(source));
+        output += 16;
+        source += 16;
+        count -= 16;
+    }
+    if (count)
+    {
+        mask = (__mmask16) ((1u << count) - 1);
+        _mm512_mask_storeu_ps(output, mask,
+                              _mm512_maskz_loadu_ps(mask, source));
     }
 }
 
-//-----------------------------------------------------------------------------
+#endif // RINGER_X86
 
 
 /*
- * Frees dynamic memory associated with the plugin instance.  The host
- * better send the right pointer in or there's gonna be a leak!
+ * Makes sure all of the non-temporal stores so far are finished.
  */
-void cleanup_Ringer(LADSPA_Handle instance)
+static inline void stream_fence()
 {
-    if (instance)
-        free(instance);
+#ifdef RINGER_X86
+    _mm_sfence();
+#endif
 }
 
-//-----------------------------------------------------------------------------
 
 /*
- * Global LADSPA_Descriptor variable used in _init(), ladspa_descriptor(),
- * and _fini().
+ * The group fill kernels fill the same stretch ('count' samples from
+ * 'offset') of a whole array of output buffers, each with its own value.
+ * ringer_run_batch() uses them to fill the outputs of every instance in a
+ * group in one call, with the fill loop inlined, instead of one call through
+ * the kernel pointer per buffer.
  */
-LADSPA_Descriptor * Ringer_descriptor = NULL;
+typedef void (*Ringer_group_fill_function)(LADSPA_Data * const * outputs,
+                                           unsigned long offset,
+                                           const LADSPA_Data * values,
+                                           unsigned long channel_count,
+                                           unsigned long count);
+
+#define DEFINE_GROUP_FILL_KERNEL(isa, target) \
+        target \
+        static void fill_group_##isa(LADSPA_Data * const * outputs, \
+                                     unsigned long offset, \
+                                     const LADSPA_Data * values, \
+                                     unsigned long channel_count, \
+                                     unsigned long count) \
+        { \
+            unsigned long channel; \
+            for (channel = 0; channel < channel_count; ++channel) \
+                fill_##isa(outputs[channel] + offset, values[channel], count); \
+        }
+
+DEFINE_GROUP_FILL_KERNEL(scalar, )
+#ifdef RINGER_X86
+DEFINE_GROUP_FILL_KERNEL(sse2, __attribute__((target("sse2"))))
+DEFINE_GROUP_FILL_KERNEL(avx2, __attribute__((target("avx2"))))
+DEFINE_GROUP_FILL_KERNEL(avx512, __attribute__((target("avx512f"))))
+#endif
 
 
 /*
- * The _init() function is called whenever this plugin is first loaded
- * by the host using it (when the host program is first opened).
+ * The step kernels do the band-limited plugin's work for one hold (see
+ * BAND-LIMITED STEPS below).  The hold's step, 'step' times the first
+ * 'residual_length' samples of 'residual', is added to the corrections that
+ * are still 'pending' from earlier steps, and then the first 'count' of
+ * those (times 'gain') are added to the output and cleared.  They are plain
+ * loops over short arrays, which the compiler turns into vector code for
+ * each instruction set.
  */
-void _init()
-{
-    /*
-     * allocate memory for Ringer_descriptor (it's just a pointer at this
-     * point).
-     * In other words create an actual LADSPA_Descriptor struct instance that
-     * Ringer_descriptor will point to.
-     */
-    Ringer_descriptor = (LADSPA_Descriptor *)
-            malloc(sizeof (LADSPA_Descriptor));
+typedef void (*Ringer_step_function)(LADSPA_Data * __restrict output,
+                                     LADSPA_Data * __restrict pending,
+                                     const LADSPA_Data * __restrict residual,
+                                     unsigned long residual_length,
+                                     LADSPA_Data step, LADSPA_Data gain,
+                                     unsigned long count);
+
+#define DEFINE_STEP_KERNEL(isa, target) \
+        target \
+        static void add_step_##isa(LADSPA_Data * __restrict output, \
+                                   LADSPA_Data * __restrict pending, \
+                                   const LADSPA_Data * __restrict residual, \
+                                   unsigned long residual_length, \
+                                   LADSPA_Data step, LADSPA_Data gain, \
+                                   unsigned long count) \
+        { \
+            unsigned long i; \
+            for (i = 0; i < residual_length; ++i) \
+                pending[i] += step * residual[i]; \
+            for (i = 0; i < count; ++i) \
+            { \
+                output[i] += gain * pending[i]; \
+                pending[i] = 0.0f; \
+            } \
+        }
 
-    // make sure malloc worked properly before initializing the struct fields
-    if (Ringer_descriptor)
-    {
-        // assign the unique ID of the plugin given by Richard Furse
-        Ringer_descriptor->UniqueID = UNIQUE_ID;
+DEFINE_STEP_KERNEL(scalar, )
+#ifdef RINGER_X86
+DEFINE_STEP_KERNEL(sse2, __attribute__((target("sse2"))))
+DEFINE_STEP_KERNEL(avx2, __attribute__((target("avx2"))))
+DEFINE_STEP_KERNEL(avx512, __attribute__((target("avx512f"))))
+#endif
 
-        /*
-         * assign the label of the plugin. since there are no control features
-         * for this plugin, "Ringer" is fine. (NOTE: it must not have white
-         * spaces as per ladspa.h).
-         * NOTE: in case you were wondering, strdup() from the string library
-         * makes a duplicate string of the argument and returns the duplicate's
-         * pointer (a char *).
-         */
-        Ringer_descriptor->Label = strdup("Ringer");
 
-        /*
-         * assign the special property of the plugin, which is any of the three
-         * defined in ladspa.h: LADSPA_PROPERTY_REALTIME,
-         * LADSPA_PROPERTY_INPLACE_BROKEN, and LADSPA_PROPERTY_HARD_RT_CAPABLE.
-         * They are just ints (1, 2, and 4, respectively).  See ladspa.h for
-         * what they actually mean.
-         */
-        Ringer_descriptor->Properties = LADSPA_PROPERTY_HARD_RT_CAPABLE;
+/*
+ * Fill kernels for one exact hold length.  With the length known at compile
+ * time, the compiler can lay out the whole hold as a fixed sequence of vector
+ * stores (no loop, no head/tail checks).  There is one set of these for each
+ * instruction set, generated by the macros below for the hold lengths that get
+ * used the most.  run() uses them for every hold that fits completely in the
+ * buffer; a hold that is split between two buffers uses the generic kernel.
+ *
+ * NOTE: these have the same arguments as the other fill kernels so they can
+ * share the same table, but 'count' is ignored (it is always 'length').
+ */
+#define SPECIALIZED_HOLD_LENGTHS(MACRO, isa) \
+        MACRO(isa, 5) MACRO(isa, 6) MACRO(isa, 7) MACRO(isa, 8) \
+        MACRO(isa, 9) MACRO(isa, 10) MACRO(isa, 11) MACRO(isa, 12) \
+        MACRO(isa, 13) MACRO(isa, 14) MACRO(isa, 15) MACRO(isa, 16) \
+        MACRO(isa, 32) MACRO(isa, 64) MACRO(isa, 128) MACRO(isa, 200)
+
+#define DEFINE_HOLD_KERNEL(isa, length) \
+        static void hold_##isa##_##length(LADSPA_Data * output, \
+                                          LADSPA_Data value, \
+                                          unsigned long count) \
+        { \
+            int i; \
+            (void) count; \
+            for (i = 0; i < length; ++i) \
+                output[i] = value; \
+        }
 
-        // assign the plugin name
-        Ringer_descriptor->Name = strdup("Ringer");
+// the targets the kernels are compiled for (the generic ones use whatever the
+// rest of the file is compiled for)
+#define TARGET_generic
+#define TARGET_avx2 __attribute__((target("avx2")))
+#define TARGET_avx512 __attribute__((target("avx512f")))
 
-        // assign the author of the plugin
-        Ringer_descriptor->Maker = strdup("Tyler Hayes (tgh@pdx.edu)");
+#define DEFINE_TARGETED_HOLD_KERNEL(isa, length) \
+        TARGET_##isa DEFINE_HOLD_KERNEL(isa, length)
 
-        /*
-         * assign the copyright info of the plugin (NOTE: use "None" for no
-         * copyright as per ladspa.h)
-         */
-        Ringer_descriptor->Copyright = strdup("GPL");
+SPECIALIZED_HOLD_LENGTHS(DEFINE_TARGETED_HOLD_KERNEL, generic)
+#ifdef RINGER_X86
+SPECIALIZED_HOLD_LENGTHS(DEFINE_TARGETED_HOLD_KERNEL, avx2)
+SPECIALIZED_HOLD_LENGTHS(DEFINE_TARGETED_HOLD_KERNEL, avx512)
+#endif
 
-        // assign the number of ports for the plugin.
-        Ringer_descriptor->PortCount = PORT_COUNT;
+// puts a set of the kernels above into the hold_kernels table (below)
+#define SELECT_HOLD_KERNEL(isa, length) \
+        hold_kernels[length] = hold_##isa##_##length;
 
-        /*
-         * used for allocating and initailizing a LADSPA_PortDescriptor array
-         * (which is an array of ints) since Adt_descriptor-> PortDescriptors
-         * is a const *.
-         */
-        LADSPA_PortDescriptor * temp_descriptor_array;
 
-        // allocate space for the temporary array with a length of the number
-        // of ports (PortCount)
-        temp_descriptor_array = (LADSPA_PortDescriptor *)
-                calloc(PORT_COUNT, sizeof (LADSPA_PortDescriptor));
+/*
+ * Fill kernels for the integer PCM functions (ringer_run_int16() and
+ * ringer_run_int24(), see sb_ringer.h).  They do the same as the float
+ * kernels, on 16-bit samples and on packed 24-bit samples (3 bytes each, so a
+ * vector holds 5 and a third of them).
+ */
+typedef void (*Ringer_int16_fill_function)(int16_t * output, int16_t value,
+                                           unsigned long count);
+typedef void (*Ringer_int24_fill_function)(unsigned char * output,
+                                           uint32_t value,
+                                           unsigned long count);
 
-        /*
-         * set the instance LADSPA_PortDescriptor array (PortDescriptors)
-         * pointer to the location temp_descriptor_array is pointing at.
-         */
-        Ringer_descriptor->PortDescriptors = (const LADSPA_PortDescriptor *)
-                temp_descriptor_array;
 
-        /*
-         * set the port properties by ORing specific bit masks defined in
-         * ladspa.h.
-         *
-         * this one gives the control port that defines the number of sample
-         * copies the properties that tell the host that this port takes input
-         * (from the user) and is a control port (a port that is controlled by
-         * the user).
-         */
-        temp_descriptor_array[RINGER_COPY_COUNT] = LADSPA_PORT_INPUT |
-                LADSPA_PORT_CONTROL;
+static void fill_int16_scalar(int16_t * output, int16_t value,
+                              unsigned long count)
+{
+    unsigned long i;
 
-        /*
-         * this one gives the input port the properties that tell the host that
-         * this port takes input and is an audio port (not a control port).
-         */
-        temp_descriptor_array[RINGER_INPUT] = LADSPA_PORT_INPUT |
-                LADSPA_PORT_AUDIO;
+    for (i = 0; i < count; ++i)
+        output[i] = value;
+}
 
-        /*
-         * this gives the output port the properties that tell the host that
-         * this port is an output port and that it is an audio port (I don't
-         * see any situation where one might be an output port, but not an
-         * audio port...).
-         */
-        temp_descriptor_array[RINGER_OUTPUT] = LADSPA_PORT_OUTPUT |
-                LADSPA_PORT_AUDIO;
 
-        /*
-         * set temp_descriptor_array to NULL for housekeeping--we don't need
-         * that local variable anymore.
-         */
-        temp_descriptor_array = NULL;
+/*
+ * The 24-bit samples are copied byte by byte ('value' holds the 3 bytes of
+ * the sample in its low 3 bytes, in the order they are in memory).
+ */
+static void fill_int24_scalar(unsigned char * output, uint32_t value,
+                              unsigned long count)
+{
+    unsigned long i;
 
-        /*
-         * temporary local variable (which is a pointer to an array of arrays
-         * of characters) for the names of the ports since Adt_descriptor->
-         * PortNames is a const char * const *.
-         */
-        char ** temp_port_names;
+    for (i = 0; i < count; ++i)
+    {
+        output[3 * i] = value & 0xFF;
+        output[3 * i + 1] = (value >> 8) & 0xFF;
+        output[3 * i + 2] = (value >> 16) & 0xFF;
+    }
+}
 
-        // allocate the space for two port names
-        temp_port_names = (char **) calloc(PORT_COUNT, sizeof (char *));
+#ifdef RINGER_X86
 
-        /*
-         * set the instance PortNames array pointer to the location
-         * temp_port_names is pointing at.
-         */
-        Ringer_descriptor->PortNames = (const char **) temp_port_names;
+/*
+ * SSE2 16-bit kernel (8 samples per store).  Like the float kernels, the
+ * last store is lined up with the end of the buffer and overlaps the one
+ * before it instead of finishing up one sample at a time.
+ */
+__attribute__((target("sse2")))
+static void fill_int16_sse2(int16_t * output, int16_t value,
+                            unsigned long count)
+{
+    unsigned long i;
 
-        // set the name of the control port for the number of sample copies to
-        // be made
-        temp_port_names[RINGER_COPY_COUNT] = strdup("Copies (samples)");
+    if (count < 8)
+    {
+        fill_int16_scalar(output, value, count);
+        return;
+    }
 
-        // set the name of the input port
-        temp_port_names[RINGER_INPUT] = strdup("Input");
+    const __m128i broadcast = _mm_set1_epi16(value);
+    for (i = 0; i + 8 <= count; i += 8)
+        _mm_storeu_si128((__m128i *) (output + i), broadcast);
+    if (i < count)
+        _mm_storeu_si128((__m128i *) (output + count - 8), broadcast);
+}
 
-        // set the name of the ouput port
-        temp_port_names[RINGER_OUTPUT] = strdup("Output");
+/*
+ * AVX2 16-bit kernel (16 samples per store).
+ */
+__attribute__((target("avx2")))
+static void fill_int16_avx2(int16_t * output, int16_t value,
+                            unsigned long count)
+{
+    unsigned long i;
 
-        // reset temp variable to NULL for housekeeping
-        temp_port_names = NULL;
+    if (count < 16)
+    {
+        fill_int16_sse2(output, value, count);
+        return;
+    }
 
-        /*
-         * temporary local variable (pointerto a PortRangeHint struct) since
-         * Adt_descriptor->PortRangeHints is a const *.
-         */
-        LADSPA_PortRangeHint * temp_hints;
+    const __m256i broadcast = _mm256_set1_epi16(value);
+    for (i = 0; i + 16 <= count; i += 16)
+        _mm256_storeu_si256((__m256i *) (output + i), broadcast);
+    if (i < count)
+        _mm256_storeu_si256((__m256i *) (output + count - 16), broadcast);
+}
 
-        // allocate space for two port hints (see ladspa.h for info on 'hints')
-        temp_hints = (LADSPA_PortRangeHint *)
-                calloc(PORT_COUNT, sizeof (LADSPA_PortRangeHint));
+/*
+ * SSSE3 24-bit kernel.  The 3-byte sample doesn't fit evenly in a vector,
+ * so there are three 16-byte patterns, each starting at a different byte of
+ * the sample, made by shuffling the sample's bytes around.  A store at byte
+ * offset 'o' of the hold uses pattern o % 3; since each store moves 16 bytes
+ * on (16 % 3 == 1), the stores just go through the patterns in order.
+ */
+__attribute__((target("ssse3")))
+static void fill_int24_ssse3(unsigned char * output, uint32_t value,
+                             unsigned long count)
+{
+    const unsigned long bytes = count * 3;
+    unsigned long offset;
+    int pattern;
 
-        /*
-         * set the instance PortRangeHints pointer to the location temp_hints
-         * is pointed at.
-         */
-        Ringer_descriptor->PortRangeHints = (const LADSPA_PortRangeHint *)
-                temp_hints;
+    if (bytes < 16)
+    {
+        fill_int24_scalar(output, value, count);
+        return;
+    }
 
-        /*
-         * set the port hint descriptors (which are ints).
-         * For the control port, the BOUNDED masks from
-         * ladspa.h tell the host that this control has limits (this one is 5
-         * and 200 as defined in the Macro at the top).
-         * The DEFAULT_LOW mask tells the host to set the control value upon
-         * start (like for a gui) to a low value between the bounds.
-         * The INTEGER mask tells the host that the control values should be in
-         * integers.
-         */
-        temp_hints[RINGER_COPY_COUNT].HintDescriptor =
-                (LADSPA_HINT_BOUNDED_BELOW
-                 | LADSPA_HINT_BOUNDED_ABOVE
-                 | LADSPA_HINT_DEFAULT_LOW
-                 | LADSPA_HINT_INTEGER);
-        // set the lower bound of the control
-        temp_hints[RINGER_COPY_COUNT].UpperBound = (LADSPA_Data) MAX_COPIES;
-        // set the upper bound of the control
-        temp_hints[RINGER_COPY_COUNT].LowerBound = (LADSPA_Data) MIN_COPIES;
-        // input and ouput don't need any range hints
-        temp_hints[RINGER_INPUT].HintDescriptor = 0;
-        temp_hints[RINGER_OUTPUT].HintDescriptor = 0;
+    const __m128i sample = _mm_cvtsi32_si128((int) value);
+    const __m128i patterns[3] =
+    {
+        _mm_shuffle_epi8(sample, _mm_setr_epi8(0, 1, 2, 0, 1, 2, 0, 1,
+                                               2, 0, 1, 2, 0, 1, 2, 0)),
+        _mm_shuffle_epi8(sample, _mm_setr_epi8(1, 2, 0, 1, 2, 0, 1, 2,
+                                               0, 1, 2, 0, 1, 2, 0, 1)),
+        _mm_shuffle_epi8(sample, _mm_setr_epi8(2, 0, 1, 2, 0, 1, 2, 0,
+                                               1, 2, 0, 1, 2, 0, 1, 2))
+    };
+
+    for (offset = 0, pattern = 0; offset + 16 <= bytes; offset += 16)
+    {
+        _mm_storeu_si128((__m128i *) (output + offset), patterns[pattern]);
+        pattern = (pattern == 2) ? 0 : pattern + 1;
+    }
+    if (offset < bytes)
+        _mm_storeu_si128((__m128i *) (output + bytes - 16),
+                         patterns[(bytes - 16) % 3]);
+}
+
+/*
+ * AVX2 24-bit kernel.  Same idea with 32-byte patterns (32 % 3 == 2, so the
+ * stores go through the patterns two at a time).  The shuffle only works
+ * within each 16-byte half, so each half has its own byte order.
+ */
+__attribute__((target("avx2")))
+static void fill_int24_avx2(unsigned char * output, uint32_t value,
+                            unsigned long count)
+{
+    const unsigned long bytes = count * 3;
+    unsigned long offset;
+    int pattern;
 
-        // reset temp variable to NULL for housekeeping
-        temp_hints = NULL;
+    if (bytes < 32)
+    {
+        fill_int24_ssse3(output, value, count);
+        return;
+    }
 
-        // set the instance's function pointers to appropriate functions
-        Ringer_descriptor->instantiate = instantiate_Ringer;
-        Ringer_descriptor->connect_port = connect_port_to_Ringer;
-        Ringer_descriptor->activate = NULL;
-        Ringer_descriptor->run = run_Ringer;
-        Ringer_descriptor->run_adding = NULL;
-        Ringer_descriptor->set_run_adding_gain = NULL;
-        Ringer_descriptor->deactivate = NULL;
-        Ringer_descriptor->cleanup = cleanup_Ringer;
+    const __m256i sample = _mm256_set1_epi32((int) value);
+    const __m256i patterns[3] =
+    {
+        _mm256_shuffle_epi8(sample, _mm256_setr_epi8(
+                0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0,
+                1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1)),
+        _mm256_shuffle_epi8(sample, _mm256_setr_epi8(
+                1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1,
+                2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2)),
+        _mm256_shuffle_epi8(sample, _mm256_setr_epi8(
+                2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2,
+                0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0))
+    };
+
+    for (offset = 0, pattern = 0; offset + 32 <= bytes; offset += 32)
+    {
+        _mm256_storeu_si256((__m256i *) (output + offset),
+                            patterns[pattern]);
+        pattern = (pattern == 0) ? 2 : pattern - 1;
     }
+    if (offset < bytes)
+        _mm256_storeu_si256((__m256i *) (output + bytes - 32),
+                            patterns[(bytes - 32) % 3]);
 }
 
-//-----------------------------------------------------------------------------
+#endif // RINGER_X86
 
 
 /*
- * Returns a descriptor of this plugin.
- *
- * NOTE: this function MUST be called 'ladspa_descriptor' or else the plugin
- * will not be recognized.
+ * The fill and adding kernels used by run() and run_adding().  They start out
+ * as the plain C ones so the plugin still works if a host somehow calls run()
+ * before _init().
  */
-const LADSPA_Descriptor * ladspa_descriptor(unsigned long index)
-{
-    if (index == 0)
-        return Ringer_descriptor;
-    else
-        return NULL;
-}
+static Ringer_fill_function fill_samples = fill_scalar;
+static Ringer_fill_function add_samples = add_scalar;
+static Ringer_stream_function stream_samples = stream_scalar;
+static Ringer_group_fill_function fill_group = fill_group_scalar;
+static Ringer_step_function add_step = add_step_scalar;
 
-//-----------------------------------------------------------------------------
+// and the ones used by the integer PCM functions
+static Ringer_int16_fill_function fill_int16 = fill_int16_scalar;
+static Ringer_int24_fill_function fill_int24 = fill_int24_scalar;
 
+// run() blocks this long or longer are streamed (off until a program turns it
+// on with ringer_set_streaming_threshold())
+static unsigned long streaming_threshold = ~0UL;
 
 /*
- * This is called automatically when the host quits (when this dynamic library
- * is unloaded).  It frees all dynamically allocated memory associated with
- * the descriptor.
+ * The fill kernel for a whole hold of each possible length (indexed by the
+ * clamped copy count).  Lengths without a specialized kernel use the generic
+ * fill kernel.
+ *
+ * NOTE: the [0 ... MAX_COPIES] range is a GCC extension.
  */
-void _fini()
-{
-    if (Ringer_descriptor)
-    {
-        free((char *) Ringer_descriptor->Label);
-        free((char *) Ringer_descriptor->Name);
-        free((char *) Ringer_descriptor->Maker);
-        free((char *) Ringer_descriptor->Copyright);
-        free((LADSPA_PortDescriptor *) Ringer_descriptor->PortDescriptors);
+static Ringer_fill_function hold_kernels[MAX_COPIES + 1] =
+        { [0 ... MAX_COPIES] = fill_scalar };
 
-        int i = 0;
-        for (i = 0; i < Ringer_descriptor->PortCount; ++i)
-            free((char *) (Ringer_descriptor->PortNames[i]));
 
-        free((char **) Ringer_descriptor->PortNames);
-        free((LADSPA_PortRangeHint *) Ringer_descriptor->PortRangeHints);
+/*
+ * Picks the fastest fill and adding kernels the processor supports, going no
+ * further than the instruction set 'kernels' (one of the RINGER_KERNELS_
+ * values in sb_ringer.h, possibly with RINGER_KERNELS_GENERIC_HOLDS).  Called
+ * from _init() with RINGER_KERNELS_BEST, and from ringer_use_kernels().
+ *
+ * NOTE: __builtin_cpu_init() has to be called by hand here because _init()
+ * runs before the constructors that would normally do it.
+ */
+static void select_fill_kernels(int kernels)
+{
+    const int generic_holds = kernels & RINGER_KERNELS_GENERIC_HOLDS;
+    int length;
+
+    kernels &= ~RINGER_KERNELS_GENERIC_HOLDS;
+    if (kernels == RINGER_KERNELS_BEST)
+        kernels = RINGER_KERNELS_AVX512;
+
+    fill_samples = fill_scalar;
+    add_samples = add_scalar;
+    stream_samples = stream_scalar;
+    fill_group = fill_group_scalar;
+    add_step = add_step_scalar;
+
+#ifdef RINGER_X86
+    __builtin_cpu_init();
+
+    if (kernels >= RINGER_KERNELS_AVX512 && __builtin_cpu_supports("avx512f"))
+    {
+        fill_samples = fill_avx512;
+        add_samples = add_avx512;
+        stream_samples = stream_avx512;
+        fill_group = fill_group_avx512;
+        add_step = add_step_avx512;
+    }
+    else if (kernels >= RINGER_KERNELS_AVX2 && __builtin_cpu_supports("avx2"))
+    {
+        fill_samples = fill_avx2;
+        add_samples = add_avx2;
+        stream_samples = stream_avx2;
+        fill_group = fill_group_avx2;
+        add_step = add_step_avx2;
+    }
+    else if (kernels >= RINGER_KERNELS_SSE2 && __builtin_cpu_supports("sse2"))
+    {
+        fill_samples = fill_sse2;
+        add_samples = add_sse2;
+        stream_samples = stream_sse2;
+        fill_group = fill_group_sse2;
+        add_step = add_step_sse2;
+    }
+#endif
+
+    // the integer kernels stop at AVX2 (16-bit vector stores with a mask
+    // would need AVX-512BW as well)
+    fill_int16 = fill_int16_scalar;
+    fill_int24 = fill_int24_scalar;
+
+#ifdef RINGER_X86
+    if (kernels >= RINGER_KERNELS_AVX2 && __builtin_cpu_supports("avx2"))
+    {
+        fill_int16 = fill_int16_avx2;
+        fill_int24 = fill_int24_avx2;
+    }
+    else if (kernels >= RINGER_KERNELS_SSE2)
+    {
+        if (__builtin_cpu_supports("sse2"))
+            fill_int16 = fill_int16_sse2;
+        if (__builtin_cpu_supports("ssse3"))
+            fill_int24 = fill_int24_ssse3;
+    }
+#endif
+
+    // every hold length gets the generic kernel, then the specialized ones
+    // for the instruction set picked above replace it where there is one
+    for (length = 0; length <= MAX_COPIES; ++length)
+        hold_kernels[length] = fill_samples;
+
+    if (generic_holds)
+        return;
+
+#ifdef RINGER_X86
+    if (fill_samples == fill_avx512)
+    {
+        SPECIALIZED_HOLD_LENGTHS(SELECT_HOLD_KERNEL, avx512)
+    }
+    else if (fill_samples == fill_avx2)
+    {
+        SPECIALIZED_HOLD_LENGTHS(SELECT_HOLD_KERNEL, avx2)
+    }
+    else
+#endif
+    {
+        SPECIALIZED_HOLD_LENGTHS(SELECT_HOLD_KERNEL, generic)
+    }
+}
+
+
+//-----------------
+//-- DIAGNOSTICS --
+//-----------------
+/*
+ * Diagnostic events from run() are kept in a ring buffer that any number of
+ * audio threads can write to without ever waiting on each other or on the
+ * reader: a writer takes the next slot number with a single atomic add and
+ * fills that slot in.  If the reader falls behind, the oldest events are
+ * simply overwritten (and counted as lost).
+ *
+ * Each slot has a sequence number that tells the reader which event is in it
+ * and whether it is finished: 2 * n + 1 while event number n is being written,
+ * and 2 * n + 2 once it is done.  The reader checks the sequence number before
+ * and after copying a slot, so it can tell if a writer got in the way.
+ */
+typedef struct
+{
+    unsigned long sequence;
+    Ringer_event event;
+} Event_slot;
+
+static Event_slot event_ring[EVENT_RING_SIZE];
+// total number of events ever written (the next event's number)
+static unsigned long events_written = 0;
+// number of the next event to be read (only used by the reader)
+static unsigned long events_read = 0;
+// number of events overwritten before they were read
+static unsigned long events_lost = 0;
+
+
+/*
+ * Records a diagnostic event.  This is what run() calls instead of printf().
+ * It never blocks, never allocates and finishes in a fixed number of steps,
+ * so it is safe to call from the audio thread.
+ */
+static void push_event(int code, const void * instance,
+                       unsigned long sample_count)
+{
+    struct timespec now;
+    const unsigned long number =
+            __atomic_fetch_add(&events_written, 1, __ATOMIC_RELAXED);
+    Event_slot * slot = &event_ring[number & (EVENT_RING_SIZE - 1)];
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    // mark the slot as being written before touching the event
+    __atomic_store_n(&slot->sequence, 2 * number + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    __atomic_store_n(&slot->event.code, code, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->event.instance, instance, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->event.sample_count, sample_count,
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->event.timestamp,
+                     (unsigned long long) now.tv_sec * 1000000000ULL
+                     + now.tv_nsec, __ATOMIC_RELAXED);
+
+    // publish it
+    __atomic_store_n(&slot->sequence, 2 * number + 2, __ATOMIC_RELEASE);
+}
+
+
+/*
+ * See sb_ringer.h.  This is the (single) reader's side of the ring buffer.
+ */
+unsigned long ringer_read_events(Ringer_event * events,
+                                 unsigned long max_events)
+{
+    unsigned long count = 0;
+
+    while (count < max_events)
+    {
+        const unsigned long written =
+                __atomic_load_n(&events_written, __ATOMIC_ACQUIRE);
+
+        if (events_read == written)
+            break;
+
+        // skip whatever has already been overwritten
+        if (written - events_read > EVENT_RING_SIZE)
+        {
+            __atomic_fetch_add(&events_lost,
+                               written - EVENT_RING_SIZE - events_read,
+                               __ATOMIC_RELAXED);
+            events_read = written - EVENT_RING_SIZE;
+        }
+
+        Event_slot * slot = &event_ring[events_read & (EVENT_RING_SIZE - 1)];
+        const unsigned long expected = 2 * events_read + 2;
+        const unsigned long before =
+                __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+
+        // the writer hasn't finished this one yet, so try again next time
+        if ((long) (before - expected) < 0)
+            break;
+
+        Ringer_event event;
+        event.code = __atomic_load_n(&slot->event.code, __ATOMIC_RELAXED);
+        event.instance = __atomic_load_n(&slot->event.instance,
+                                         __ATOMIC_RELAXED);
+        event.sample_count = __atomic_load_n(&slot->event.sample_count,
+                                             __ATOMIC_RELAXED);
+        event.timestamp = __atomic_load_n(&slot->event.timestamp,
+                                          __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        // only keep it if nobody started overwriting the slot in the meantime
+        if (before == expected
+            && __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) == expected)
+            events[count++] = event;
+        else
+            __atomic_fetch_add(&events_lost, 1, __ATOMIC_RELAXED);
+
+        ++events_read;
+    }
+
+    return count;
+}
+
+
+/*
+ * See sb_ringer.h.
+ */
+unsigned long ringer_lost_events()
+{
+    return __atomic_load_n(&events_lost, __ATOMIC_RELAXED);
+}
+
+
+//-----------------
+//-- LOAD TIMING --
+//-----------------
+/*
+ * The DSP load plugin times each run() with the cheapest clock there is: the
+ * processor's time stamp counter on x86 (a single instruction), or
+ * CLOCK_MONOTONIC everywhere else.  The time stamp counter ticks at a fixed
+ * rate on any x86 processor from the last 15 years or so, but that rate isn't
+ * written down anywhere, so it is measured against CLOCK_MONOTONIC.  That
+ * takes a millisecond of busy waiting, so it is only done the first time a
+ * DSP load plugin is instantiated, not when a host loads the library (which
+ * it may well do just to list the plugins).
+ */
+static double clock_ticks_per_second = 1e9;
+static pthread_once_t clock_calibrated = PTHREAD_ONCE_INIT;
+
+
+static inline unsigned long long read_clock()
+{
+#ifdef RINGER_X86
+    return __rdtsc();
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+
+/*
+ * Works out clock_ticks_per_second.  Called once, through clock_calibrated,
+ * by instantiate().
+ */
+static void calibrate_clock()
+{
+#ifdef RINGER_X86
+    struct timespec start, now;
+    unsigned long long start_ticks, ticks;
+    long long elapsed;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    start_ticks = read_clock();
+    do
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        elapsed = (now.tv_sec - start.tv_sec) * 1000000000LL
+                  + (now.tv_nsec - start.tv_nsec);
+    } while (elapsed < CLOCK_CALIBRATION_TIME);
+    ticks = read_clock() - start_ticks;
+
+    clock_ticks_per_second = (double) ticks * 1e9 / elapsed;
+#endif
+}
+
+
+//------------------------
+//-- BAND-LIMITED STEPS --
+//------------------------
+/*
+ * Holding a sample turns the input into a staircase, and the sharp corners
+ * of the stairs are what make Ringer sound so harsh: they put copies of the
+ * (held) signal's spectrum all the way up the audio band.  The band-limited
+ * plugin rounds the corners off by replacing each step between two holds
+ * with a smooth, band-limited one, the same trick band-limited oscillators
+ * use (a "minBLEP").  A step from a to b is written out as the hard step, as
+ * usual, plus (b - a) times a "residual": the difference between the smooth
+ * step and the hard one, which dies away to nothing a few holds later.  That
+ * is exactly the same as running the staircase through a low-pass filter,
+ * but the work is only done once per hold, not once per sample.
+ *
+ * The smooth step is the running sum of a windowed sinc pulse that has been
+ * turned into its minimum-phase version (so it all comes after the step and
+ * nothing has to be delayed), worked out once in _init().  It is stretched to
+ * the hold length, which puts the cut-off at half the rate at which the holds
+ * go by (where the hold's first copy of the spectrum starts).  Holds longer
+ * than BLEP_MAX_STRETCH samples share the step made for that length, which
+ * keeps every step to BLEP_MAX_LENGTH samples at most.
+ *
+ * NOTE: step_residuals[n] is the residual for holds of n samples (the rows
+ * below MIN_COPIES aren't used).  Its first BLEP_SPAN * n samples are the
+ * residual and the rest are 0.
+ */
+static LADSPA_Data step_residuals[BLEP_MAX_STRETCH + 1][BLEP_MAX_LENGTH]
+        __attribute__((aligned(64)));
+
+
+/*
+ * A plain radix-2 FFT of 'size' (a power of 2) complex numbers, in place,
+ * used to make the step.  The inverse transform is scaled by 1 / size.
+ */
+static void fft(double * real, double * imaginary, unsigned long size,
+                int inverse)
+{
+    unsigned long i, j, k;
+    unsigned long length;
+
+    // put the samples in bit-reversed order
+    for (i = 1, j = 0; i < size; ++i)
+    {
+        unsigned long bit = size >> 1;
+
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+
+        if (i < j)
+        {
+            double swap = real[i];
+            real[i] = real[j];
+            real[j] = swap;
+            swap = imaginary[i];
+            imaginary[i] = imaginary[j];
+            imaginary[j] = swap;
+        }
+    }
+
+    // then combine them into ever longer transforms
+    for (length = 2; length <= size; length <<= 1)
+    {
+        const double angle = (inverse ? 2.0 : -2.0) * M_PI / length;
+        const double step_real = cos(angle);
+        const double step_imaginary = sin(angle);
+
+        for (i = 0; i < size; i += length)
+        {
+            double twiddle_real = 1.0;
+            double twiddle_imaginary = 0.0;
+
+            for (k = 0; k < length / 2; ++k)
+            {
+                double * a_real = &real[i + k];
+                double * a_imaginary = &imaginary[i + k];
+                double * b_real = &real[i + k + length / 2];
+                double * b_imaginary = &imaginary[i + k + length / 2];
+                const double product_real = *b_real * twiddle_real
+                                            - *b_imaginary * twiddle_imaginary;
+                const double product_imaginary =
+                        *b_real * twiddle_imaginary
+                        + *b_imaginary * twiddle_real;
+                const double next_twiddle = twiddle_real * step_real
+                        - twiddle_imaginary * step_imaginary;
+
+                *b_real = *a_real - product_real;
+                *b_imaginary = *a_imaginary - product_imaginary;
+                *a_real += product_real;
+                *a_imaginary += product_imaginary;
+
+                twiddle_imaginary = twiddle_real * step_imaginary
+                                    + twiddle_imaginary * step_real;
+                twiddle_real = next_twiddle;
+            }
+        }
+    }
+
+    if (inverse)
+        for (i = 0; i < size; ++i)
+        {
+            real[i] /= size;
+            imaginary[i] /= size;
+        }
+}
+
+
+/*
+ * Fills in step_residuals.  Called once from _init().  If there isn't the
+ * memory for it, the residuals stay 0 and the band-limited plugin just does
+ * hard holds.
+ */
+static void build_step_tables()
+{
+    const unsigned long pulse_length = BLEP_SPAN * BLEP_OVERSAMPLING + 1;
+    double * real = (double *) calloc(BLEP_FFT_SIZE, sizeof (double));
+    double * imaginary = (double *) calloc(BLEP_FFT_SIZE, sizeof (double));
+    double * step = (double *) malloc((pulse_length + 1) * sizeof (double));
+    double total = 0.0;
+    unsigned long stretch;
+    unsigned long i;
+
+    if (!real || !imaginary || !step)
+    {
+        free(real);
+        free(imaginary);
+        free(step);
+        return;
+    }
+
+    // a sinc pulse with BLEP_OVERSAMPLING points per zero crossing, faded in
+    // and out with a Blackman window
+    for (i = 0; i < pulse_length; ++i)
+    {
+        const double x = ((double) i - (pulse_length - 1) / 2.0)
+                         / BLEP_OVERSAMPLING;
+        const double phase = 2.0 * M_PI * i / (pulse_length - 1);
+
+        real[i] = (x == 0.0 ? 1.0 : sin(M_PI * x) / (M_PI * x))
+                  * (0.42 - 0.5 * cos(phase) + 0.08 * cos(2.0 * phase));
+    }
+
+    /*
+     * Make it minimum phase with the real cepstrum: take the log of its
+     * spectrum's magnitude, transform that back, fold the negative
+     * "quefrencies" onto the positive ones, and undo the first two steps.
+     */
+    fft(real, imaginary, BLEP_FFT_SIZE, 0);
+    for (i = 0; i < BLEP_FFT_SIZE; ++i)
+    {
+        const double magnitude = sqrt(real[i] * real[i]
+                                      + imaginary[i] * imaginary[i]);
+
+        real[i] = log(magnitude > 1e-9 ? magnitude : 1e-9);
+        imaginary[i] = 0.0;
+    }
+    fft(real, imaginary, BLEP_FFT_SIZE, 1);
+    for (i = 1; i < BLEP_FFT_SIZE / 2; ++i)
+    {
+        real[i] *= 2.0;
+        imaginary[i] *= 2.0;
+    }
+    for (i = BLEP_FFT_SIZE / 2 + 1; i < BLEP_FFT_SIZE; ++i)
+    {
+        real[i] = 0.0;
+        imaginary[i] = 0.0;
+    }
+    fft(real, imaginary, BLEP_FFT_SIZE, 0);
+    for (i = 0; i < BLEP_FFT_SIZE; ++i)
+    {
+        const double magnitude = exp(real[i]);
+        const double phase = imaginary[i];
+
+        real[i] = magnitude * cos(phase);
+        imaginary[i] = magnitude * sin(phase);
+    }
+    fft(real, imaginary, BLEP_FFT_SIZE, 1);
+
+    // add it up into a step from 0 to 1
+    for (i = 0; i < BLEP_FFT_SIZE; ++i)
+        total += real[i];
+    step[0] = 0.0;
+    for (i = 0; i < pulse_length; ++i)
+        step[i + 1] = step[i] + real[i] / total;
+
+    /*
+     * Stretch it to each hold length: sample 'i' of a hold of 'stretch'
+     * samples is i / stretch hold lengths after the step, which falls between
+     * two of its points.
+     */
+    for (stretch = MIN_COPIES; stretch <= BLEP_MAX_STRETCH; ++stretch)
+        for (i = 0; i < BLEP_SPAN * stretch; ++i)
+        {
+            const double position = (double) i * BLEP_OVERSAMPLING / stretch;
+            const unsigned long point = (unsigned long) position;
+            const double fraction = position - point;
+
+            step_residuals[stretch][i] = (LADSPA_Data)
+                    (step[point] + (step[point + 1] - step[point]) * fraction
+                     - 1.0);
+        }
+
+    free(real);
+    free(imaginary);
+    free(step);
+}
+
+
+//--------------------------------
+//-- STRUCT FOR PORT CONNECTION --
+//--------------------------------
+
+
+/*
+ * Each plugin in this library (mono, stereo, etc.) is described by one of
+ * these.  A pointer to it is kept in the descriptor's ImplementationData so
+ * instantiate() knows how many channels the new instance has.
+ */
+typedef struct
+{
+    // the plugin's unique ID
+    unsigned long unique_id;
+    // label and name of the plugin (the label must not have white spaces)
+    const char * label;
+    const char * name;
+    // number of audio channels (input/output port pairs)
+    unsigned long channel_count;
+    // name of each channel, used to name the ports ("L", "R", etc.)
+    const char * channel_names[MAX_CHANNELS];
+    // any of the RINGER_ flags defined at the top (0 for none)
+    unsigned long flags;
+} Ringer_variant;
+
+
+/*
+ * The band-limited plugin's steps that haven't been written out yet.
+ * pending[start] is the correction for the next output sample, and so on for
+ * the BLEP_MAX_LENGTH samples after it; everything else is 0.  Once 'start'
+ * gets past BLEP_MAX_LENGTH, what's left is moved back to the front, so the
+ * corrections for the samples ahead are always in one piece.
+ */
+typedef struct
+{
+    LADSPA_Data pending[2 * BLEP_MAX_LENGTH] __attribute__((aligned(64)));
+    unsigned long start;
+} Ringer_steps;
+
+
+/*
+ * The part of an instance only the band-limited plugin has.  The steps are
+ * over a kilobyte, so this is allocated separately, just for that plugin,
+ * which keeps every other instance (and so each of the instance pool's
+ * slots) small.
+ */
+typedef struct
+{
+    Ringer_steps steps;
+    // band-limiting control port
+    LADSPA_Data * mode;
+    // whether the band-limiting was turned on for the last block
+    int band_limiting;
+} Ringer_band_limited;
+
+
+typedef struct
+{
+    // the number of copies to be placed into the output buffer.
+    // NOTE: the number is clamped to between 5 and 200 and, for every plugin
+    // but the fractional one, truncated to an integer.  The fractional plugin
+    // keeps the fraction instead: the count becomes a 16.16 fixed-point hold
+    // length (see to_hold_step()), so 5.5 copies gives holds of 5 and 6
+    // samples in turn.  This variable is a pointer to a LADSPA_Data (a float)
+    // anyway, because the connection to data_location in the connect_port()
+    // function cannot be made unless they are of the same type.  For the
+    // audio-rate plugin it points to a whole buffer of counts, one per sample.
+    LADSPA_Data * copy_count;
+    // number of audio channels this instance processes
+    unsigned long channel_count;
+    // the RINGER_ flags of the plugin this is an instance of
+    unsigned long flags;
+    // data locations for the input & output audio ports (one per channel)
+    LADSPA_Data * Input[MAX_CHANNELS];
+    LADSPA_Data * Output[MAX_CHANNELS];
+    // the hold state, which is carried over from one run() call to the next
+    // so the output doesn't depend on how the host splits up the stream.
+    // held_samples are the input samples currently being copied (one per
+    // channel), and hold_remaining is how many more copies of them are still
+    // to be made.  All the channels share the same hold so they stay in phase.
+    LADSPA_Data held_samples[MAX_CHANNELS];
+    unsigned long hold_remaining;
+    // for the fractional plugin, the fraction of a sample (in 16.16 fixed
+    // point) that the current hold really ends after its last whole sample
+    unsigned long hold_fraction;
+    // the gain run_adding() applies to the output before adding it to the
+    // output buffer (set by the host through set_run_adding_gain())
+    LADSPA_Data run_adding_gain;
+    // DSP load output ports (only for the plugin with RINGER_LOAD_PORTS).
+    // load is the percentage of the real-time budget the last block used, and
+    // peak_load is the highest load since the plugin was activated.
+    // (peak_load_value comes first so it shares 8 bytes with run_adding_gain)
+    LADSPA_Data peak_load_value;
+    LADSPA_Data * load;
+    LADSPA_Data * peak_load;
+    // converts clock ticks per sample into a percentage of the time one sample
+    // lasts (100 * sample rate / clock_ticks_per_second)
+    double load_scale;
+    // bit depth and gain (in dB) control ports (only for the plugin with
+    // RINGER_CRUSH_PORTS)
+    LADSPA_Data * bits;
+    LADSPA_Data * gain;
+    // the band-limiting control port and state (only for the plugin with
+    // RINGER_BAND_LIMITED, NULL otherwise)
+    Ringer_band_limited * band_limited;
+} Ringer;
+
+
+/*
+ * The bit depth reduction and gain the bitcrushed plugin applies, worked out
+ * from its controls once per block.  The samples are rounded to a multiple of
+ * 1 / steps and then scaled by gain / steps in one go.
+ */
+typedef struct
+{
+    LADSPA_Data steps;
+    LADSPA_Data output_scale;
+} Ringer_crush;
+
+
+
+
+//-------------------
+//-- INSTANCE POOL --
+//-------------------
+/*
+ * Instances aren't malloc'ed one at a time.  They come out of a pool of
+ * cache-line-aligned slots, allocated a slab of INSTANCE_SLAB_SIZE at a time
+ * (the first slab in _init()).  That way no two instances ever share a cache
+ * line (which would slow both down if they were run on different threads),
+ * a host loading a session with hundreds of Ringers doesn't call malloc
+ * hundreds of times, and the instances end up next to each other in memory.
+ * cleanup() puts a slot back on the free list for the next instantiate().
+ *
+ * instantiate() and cleanup() are never called from the audio thread, so a
+ * mutex is fine for keeping the pool consistent.
+ */
+
+// a free slot holds the pointer to the next free one instead of an instance
+typedef union Ringer_slot
+{
+    Ringer ringer;
+    union Ringer_slot * next_free;
+} __attribute__((aligned(CACHE_LINE_SIZE))) Ringer_slot;
+
+
+typedef struct Ringer_slab
+{
+    // the slot array comes first so it starts on a cache line
+    Ringer_slot slots[INSTANCE_SLAB_SIZE];
+    // all of the slabs, so _fini() can free them
+    struct Ringer_slab * next;
+} Ringer_slab;
+
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static Ringer_slab * slabs = NULL;
+static Ringer_slot * free_slots = NULL;
+
+
+/*
+ * Adds another slab's worth of slots to the free list.  Returns 0 if there
+ * wasn't enough memory.  Must be called with pool_lock held.
+ */
+static int grow_pool()
+{
+    Ringer_slab * slab;
+    unsigned long i;
+
+    slab = (Ringer_slab *) aligned_alloc(CACHE_LINE_SIZE,
+                                         sizeof (Ringer_slab));
+    if (!slab)
+        return 0;
+
+    // chain the new slots so the first one is handed out first
+    for (i = 0; i < INSTANCE_SLAB_SIZE; ++i)
+        slab->slots[i].next_free = (i + 1 < INSTANCE_SLAB_SIZE)
+                ? &slab->slots[i + 1] : free_slots;
+    free_slots = &slab->slots[0];
+
+    slab->next = slabs;
+    slabs = slab;
+    return 1;
+}
+
+
+/*
+ * Takes a slot out of the pool (growing it if it's empty) and returns it
+ * zeroed, or returns NULL if there's no memory left.
+ */
+static Ringer * allocate_instance()
+{
+    Ringer_slot * slot = NULL;
+
+    pthread_mutex_lock(&pool_lock);
+    if (free_slots || grow_pool())
+    {
+        slot = free_slots;
+        free_slots = slot->next_free;
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    if (!slot)
+        return NULL;
+
+    memset(slot, 0, sizeof (Ringer_slot));
+    return &slot->ringer;
+}
+
+
+/*
+ * Puts an instance's slot back in the pool.
+ */
+static void free_instance(Ringer * ringer)
+{
+    Ringer_slot * slot = (Ringer_slot *) ringer;
+
+    pthread_mutex_lock(&pool_lock);
+    slot->next_free = free_slots;
+    free_slots = slot;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+
+/*
+ * Frees every slab (called from _fini(), when no instances should be left).
+ */
+static void destroy_pool()
+{
+    pthread_mutex_lock(&pool_lock);
+    while (slabs)
+    {
+        Ringer_slab * next = slabs->next;
+        free(slabs);
+        slabs = next;
+    }
+    free_slots = NULL;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+
+//---------------
+//-- FUNCTIONS --
+//---------------
+
+
+/*
+ * Creates a plugin instance by taking a slot for it from the instance pool.
+ * This function returns a LADSPA_Handle (which is a void * -- a pointer to
+ * anything).
+ */
+LADSPA_Handle instantiate_Ringer(const LADSPA_Descriptor * descriptor,
+                                 unsigned long sample_rate)
+{
+    const Ringer_variant * variant =
+            (const Ringer_variant *) descriptor->ImplementationData;
+    Ringer * ringer;
+
+    // probe arguments: descriptor, sample rate, number of channels (the
+    // matching instantiate_exit has the new instance instead, which is 0 if
+    // there was no memory for it)
+    RINGER_PROBE3(instantiate_entry, descriptor, sample_rate,
+                  variant->channel_count);
+
+    // get space for a Ringer struct instance (already zeroed)
+    ringer = allocate_instance();
+
+    // start with no samples being held (in case the host never calls
+    // activate())
+    if (ringer)
+    {
+        ringer->channel_count = variant->channel_count;
+        ringer->flags = variant->flags;
+        ringer->hold_remaining = 0;
+        ringer->run_adding_gain = 1.0f;
+        if (variant->flags & RINGER_LOAD_PORTS)
+        {
+            pthread_once(&clock_calibrated, calibrate_clock);
+            ringer->load_scale = 100.0 * sample_rate / clock_ticks_per_second;
+        }
+
+        if (variant->flags & RINGER_BAND_LIMITED)
+        {
+            ringer->band_limited =
+                    aligned_alloc(64, sizeof (Ringer_band_limited));
+            if (ringer->band_limited)
+                memset(ringer->band_limited, 0, sizeof (Ringer_band_limited));
+            else
+            {
+                free_instance(ringer);
+                ringer = NULL;
+            }
+        }
+    }
+
+    RINGER_PROBE3(instantiate_exit, ringer, sample_rate,
+                  variant->channel_count);
+
+    // send the LADSPA_Handle to the host.  If there was no memory left, NULL
+    // is returned.
+    return ringer;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Make a connection between a specified port and it's corresponding data
+ * location. For example, the output port should be "connected" to the place in
+ * memory where that sound data to be played is located.
+ */
+void connect_port_to_Ringer(LADSPA_Handle instance, unsigned long Port,
+                            LADSPA_Data * data_location)
+{
+    Ringer * ringer;
+
+    // cast the (void *) instance to (Ringer *) and set it to local pointer
+    ringer = (Ringer *) instance;
+
+    // direct the appropriate data pointer to the appropriate data location.
+    // the input ports come right after the control port, and the output ports
+    // right after those.
+    if (Port == RINGER_COPY_COUNT)
+        ringer->copy_count = data_location;
+    else if (Port < RINGER_INPUT + ringer->channel_count)
+        ringer->Input[Port - RINGER_INPUT] = data_location;
+    else if (Port < OUTPUT_PORT(ringer->channel_count, ringer->channel_count))
+        ringer->Output[Port - OUTPUT_PORT(0, ringer->channel_count)] =
+                data_location;
+    else if (ringer->flags & RINGER_LOAD_PORTS)
+    {
+        if (Port == RINGER_LOAD)
+            ringer->load = data_location;
+        else if (Port == RINGER_PEAK_LOAD)
+            ringer->peak_load = data_location;
+    }
+    else if (ringer->flags & RINGER_CRUSH_PORTS)
+    {
+        if (Port == RINGER_BITS)
+            ringer->bits = data_location;
+        else if (Port == RINGER_GAIN)
+            ringer->gain = data_location;
+    }
+    else if (ringer->flags & RINGER_BAND_LIMITED)
+    {
+        if (Port == RINGER_MODE)
+            ringer->band_limited->mode = data_location;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Resets the hold state so the next run() starts a fresh hold with the first
+ * sample it is given.  The host calls this before it starts running the
+ * plugin (and again after a deactivate() if it wants to start it back up).
+ */
+void activate_Ringer(LADSPA_Handle instance)
+{
+    Ringer * ringer = (Ringer *) instance;
+    unsigned long channel;
+
+    RINGER_PROBE1(activate_entry, ringer);
+
+    for (channel = 0; channel < MAX_CHANNELS; ++channel)
+        ringer->held_samples[channel] = 0.0f;
+    ringer->hold_remaining = 0;
+    ringer->hold_fraction = 0;
+    ringer->peak_load_value = 0.0f;
+    // the load outputs start at 0 too, so a host doesn't show a stale peak
+    // before the first block
+    if (ringer->load)
+        *(ringer->load) = 0.0f;
+    if (ringer->peak_load)
+        *(ringer->peak_load) = 0.0f;
+    if (ringer->band_limited)
+        memset(&ringer->band_limited->steps, 0, sizeof (Ringer_steps));
+
+    RINGER_PROBE1(activate_exit, ringer);
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Called when the host stops running the plugin.  The hold state is dropped
+ * here too, so a sample from before the pause doesn't get held over into
+ * whatever comes after it.
+ */
+void deactivate_Ringer(LADSPA_Handle instance)
+{
+    activate_Ringer(instance);
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Reduces the bit depth of a sample and applies the gain.  Like a real
+ * converter, samples past full scale clip: anything outside -1 to 1 comes
+ * out as -1 or 1 (before the gain).  The rounding is done by hand (halves
+ * away from zero) instead of with lrintf() and friends, which turn into a
+ * function call unless the processor has SSE4.1.
+ */
+static inline LADSPA_Data crush_sample(const Ringer_crush * crush,
+                                       LADSPA_Data sample)
+{
+    LADSPA_Data scaled;
+
+    if (sample > 1.0f)
+        sample = 1.0f;
+    else if (sample < -1.0f)
+        sample = -1.0f;
+
+    scaled = sample * crush->steps;
+    scaled += (scaled < 0.0f) ? -0.5f : 0.5f;
+    return (LADSPA_Data) (long) scaled * crush->output_scale;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Turns a copy count into the fractional plugin's 16.16 fixed-point hold
+ * length.  This is only done once per block (or per ringer_run_events()
+ * change), never per sample.
+ */
+static inline unsigned long to_hold_step(LADSPA_Data copy_count)
+{
+    return (unsigned long) (LIMIT_BETWEEN_5_AND_200(copy_count)
+                            * (1 << HOLD_FRACTION_BITS) + 0.5f);
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Writes out the band-limited plugin's corrections for 'copies' samples of a
+ * hold, starting at 'output'.  If the hold starts here, its 'step' (the new
+ * held sample minus the old one) is added to the pending corrections first,
+ * with the residual for holds of 'hold_length' samples.  Only the first
+ * BLEP_MAX_LENGTH samples can need correcting, so a long hold costs no more
+ * than a short one.
+ */
+static inline void write_steps(Ringer_steps * steps, LADSPA_Data * output,
+                               LADSPA_Data step, unsigned long hold_length,
+                               unsigned long copies, LADSPA_Data gain)
+{
+    const unsigned long stretch = hold_length < BLEP_MAX_STRETCH
+                                  ? hold_length : BLEP_MAX_STRETCH;
+    const unsigned long count = copies < BLEP_MAX_LENGTH
+                                ? copies : BLEP_MAX_LENGTH;
+    const unsigned long start = steps->start;
+
+    add_step(output, steps->pending + start, step_residuals[stretch],
+             step != 0.0f ? BLEP_SPAN * stretch : 0, step, gain, count);
+
+    steps->start = start + copies;
+    if (steps->start >= BLEP_MAX_LENGTH)
+    {
+        // move whatever is still to come back to the front
+        const unsigned long left = start + BLEP_MAX_LENGTH > steps->start
+                                   ? start + BLEP_MAX_LENGTH - steps->start
+                                   : 0;
+
+        memmove(steps->pending, steps->pending + steps->start,
+                left * sizeof (LADSPA_Data));
+        memset(steps->pending + left, 0,
+               (2 * BLEP_MAX_LENGTH - left) * sizeof (LADSPA_Data));
+        steps->start = 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Here is where the rubber hits the road.  This is the hold loop shared by
+ * run(), run_adding() and ringer_run_batch(): it runs 'sample_count' samples
+ * of 'channel_count' input and output buffers, all in phase.  It starts from
+ * the hold state in 'held_samples' (one per channel) and '*hold_state' (the
+ * hold_remaining count), and leaves the new state there.  When 'adding' is 0,
+ * the held samples overwrite the output buffers; otherwise they are multiplied
+ * by 'gain' and added to them.  Every hold is 'copy_count' samples long,
+ * unless 'copy_counts' (the audio-rate copy count buffer, lined up with the
+ * input buffers) isn't NULL, or 'events' (the copy count changes passed to
+ * ringer_run_events()) isn't NULL.  If 'crush' isn't NULL, the first sample of
+ * each hold is bitcrushed and scaled by it before being held, so that's only
+ * done once per hold instead of once per sample.
+ *
+ * If 'steps' isn't NULL (the band-limited plugin, which is mono), the step
+ * from each held sample to the next is smoothed out by write_steps() after
+ * the hold has been filled in.
+ *
+ * For the fractional plugin, 'fraction_state' points at its hold_fraction and
+ * the holds are 'hold_step' (16.16 fixed point) long instead.  The fractions
+ * are added up as the holds go by, like the phase accumulator of an
+ * oscillator: each hold gets the whole samples that fit and passes what's
+ * left over on to the next one.  So the hold boundaries are worked out with
+ * one add, shift and mask per hold, and the fill itself is the same as for
+ * whole numbers.
+ *
+ * 'grouped' is set by ringer_run_batch(), for which the channels are really
+ * the channels of many instances: they are filled with one group fill kernel
+ * call instead of one call each.
+ *
+ * NOTE: this is inlined into its callers with 'adding' and 'grouped' as
+ * constants, so there is no extra branching in the loop for them.
+ */
+static inline void hold_block(unsigned long channel_count,
+                              LADSPA_Data * held_samples,
+                              unsigned long * hold_state, LADSPA_Data gain,
+                              LADSPA_Data * const * inputs,
+                              LADSPA_Data * const * outputs,
+                              const LADSPA_Data * copy_counts, int copy_count,
+                              const Ringer_parameter_event * events,
+                              unsigned long event_count,
+                              const Ringer_crush * crush,
+                              Ringer_steps * steps,
+                              unsigned long * fraction_state,
+                              unsigned long hold_step,
+                              unsigned long sample_count, int adding,
+                              int grouped)
+{
+    unsigned long channel;
+
+    // the band-limited plugin's step at the start of the current hold (0
+    // while finishing one from an earlier call)
+    LADSPA_Data step = 0.0f;
+
+    // the next copy count change in 'events' to take effect
+    unsigned long event = 0;
+
+    // index into all of the input and output buffers
+    unsigned long index = 0;
+
+    // local copy of the hold count (saved back at the end)
+    unsigned long hold_remaining = *hold_state;
+
+    // same for the fractional plugin's left over fraction
+    unsigned long hold_fraction = fraction_state ? *fraction_state : 0;
+
+    // length of the hold that was started in this call (0 while finishing
+    // one from an earlier call)
+    unsigned long hold_length = 0;
+
+    /*
+     * Go through the buffers one hold at a time.  A hold that was started in
+     * an earlier run() call is finished first, and a hold that doesn't fit in
+     * what's left of this buffer is finished in the next call.  That way the
+     * output is the same whether the host hands us 32 samples at a time or
+     * 4096.
+     *
+     * All of the channels are done together, one hold at a time, rather than
+     * one whole channel after the other.  That keeps the samples being worked
+     * on for every channel in the cache at the same time.
+     *
+     * NOTE: the number of copies is only looked at when a new hold starts, so
+     * a change to the control takes effect on the next hold.  For the
+     * audio-rate plugin, the copy count buffer is read at the sample where
+     * each hold starts (it is sampled and held just like the audio), so every
+     * hold is still one bulk fill no matter how fast the copy count moves.
+     */
+    while (index < sample_count)
+    {
+        // start holding the current input samples once the last hold is done
+        // (read them all before any copies are written, in case the host gave
+        // us the same buffer for an input and an output -- see the top of
+        // the file)
+        if (hold_remaining == 0)
+        {
+            if (steps)
+                step = inputs[0][index] - held_samples[0];
+
+            for (channel = 0; channel < channel_count; ++channel)
+                held_samples[channel] = inputs[channel][index];
+
+            if (crush)
+                for (channel = 0; channel < channel_count; ++channel)
+                    held_samples[channel] =
+                            crush_sample(crush, held_samples[channel]);
+
+            // every change up to here applies to this hold (and those after
+            // it), so skip to the latest one
+            if (events)
+                for (; event < event_count && events[event].frame <= index;
+                     ++event)
+                {
+                    if (fraction_state)
+                        hold_step = to_hold_step(events[event].copy_count);
+                    else
+                        copy_count = LIMIT_BETWEEN_5_AND_200(
+                                (int) events[event].copy_count);
+                }
+
+            if (copy_counts)
+                hold_length = LIMIT_BETWEEN_5_AND_200(
+                        (int) copy_counts[index]);
+            else if (fraction_state)
+            {
+                hold_fraction += hold_step;
+                hold_length = hold_fraction >> HOLD_FRACTION_BITS;
+                hold_fraction &= (1 << HOLD_FRACTION_BITS) - 1;
+            }
+            else
+                hold_length = copy_count;
+            hold_remaining = hold_length;
+        }
+
+        // make as many copies as the hold has left, or as will fit in the
+        // rest of the output buffers, whichever is less
+        unsigned long copies = sample_count - index;
+        if (copies > hold_remaining)
+            copies = hold_remaining;
+
+        if (grouped)
+        {
+            fill_group(outputs, index, held_samples, channel_count, copies);
+            index += copies;
+            hold_remaining -= copies;
+            continue;
+        }
+
+        // a whole hold can use the kernel made for exactly its length
+        const Ringer_fill_function fill =
+                (copies == hold_length) ? hold_kernels[hold_length]
+                                        : fill_samples;
+
+        for (channel = 0; channel < channel_count; ++channel)
+        {
+            if (adding)
+                add_samples(outputs[channel] + index,
+                            held_samples[channel] * gain, copies);
+            else
+                fill(outputs[channel] + index, held_samples[channel],
+                     copies);
+        }
+
+        if (steps)
+        {
+            write_steps(steps, outputs[0] + index, step, hold_length, copies,
+                        adding ? gain : 1.0f);
+            step = 0.0f;
+        }
+
+        index += copies;
+        hold_remaining -= copies;
+    }
+
+    // save the hold count (and fraction) for the next call
+    *hold_state = hold_remaining;
+    if (fraction_state)
+        *fraction_state = hold_fraction;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * run() for huge blocks.  Writing the output the normal way would drag all of
+ * it through the cache (evicting everything else), so instead the block is
+ * done a tile at a time: each tile is held into a small buffer on the stack,
+ * which stays in the cache, and then streamed out to the real output buffer
+ * with non-temporal stores.  Since hold_block() keeps the hold state from one
+ * call to the next, this gives exactly the same output as doing the whole
+ * block at once.
+ *
+ * The buffer is only STREAM_TILE samples (4 KB) in all, split between the
+ * channels, so it's safe on a host's audio thread, which may have a small
+ * stack.  Each channel's share is rounded down to a whole number of cache
+ * lines, so every channel's part of the buffer stays aligned.
+ *
+ * The input is only read once per hold, which the hardware prefetcher doesn't
+ * predict well for long holds, so the first samples of the holds in the next
+ * tile are prefetched (with the "non-temporal" hint, so they don't stay in the
+ * cache either) while the current one is being streamed out.
+ */
+static void stream_block(Ringer * ringer, int copy_count,
+                         const Ringer_crush * crush, Ringer_steps * steps,
+                         unsigned long * fraction_state,
+                         unsigned long hold_step, unsigned long sample_count)
+{
+    LADSPA_Data tile[STREAM_TILE] __attribute__((aligned(64)));
+    LADSPA_Data * inputs[MAX_CHANNELS];
+    LADSPA_Data * tile_pointers[MAX_CHANNELS];
+    const unsigned long channel_count = ringer->channel_count;
+    // samples per channel in each tile (a multiple of 16 floats, 64 bytes)
+    const unsigned long tile_length =
+            (STREAM_TILE / channel_count) & ~15UL;
+    const int audio_rate_copies = ringer->flags & RINGER_AUDIO_RATE_COPIES;
+    // distance between the prefetched samples: one per hold, or one per
+    // cache line when the holds are shorter than that (or vary)
+    const unsigned long prefetch_stride =
+            (audio_rate_copies || copy_count < 16) ? 16 : copy_count;
+    unsigned long start;
+    unsigned long channel;
+    unsigned long index;
+
+    for (channel = 0; channel < channel_count; ++channel)
+        tile_pointers[channel] = tile + channel * tile_length;
+
+    for (start = 0; start < sample_count; start += tile_length)
+    {
+        unsigned long length = sample_count - start;
+        if (length > tile_length)
+            length = tile_length;
+
+        for (channel = 0; channel < channel_count; ++channel)
+            inputs[channel] = ringer->Input[channel] + start;
+
+        hold_block(channel_count, ringer->held_samples,
+                   &ringer->hold_remaining, 1.0f, inputs, tile_pointers,
+                   audio_rate_copies ? ringer->copy_count + start : NULL,
+                   copy_count, NULL, 0, crush, steps, fraction_state,
+                   hold_step, length, 0, 0);
+
+        // the next hold starts hold_remaining samples after this tile
+        const unsigned long next_tile = start + length;
+        unsigned long next_end = next_tile + tile_length;
+        if (next_end > sample_count)
+            next_end = sample_count;
+
+        for (channel = 0; channel < channel_count; ++channel)
+        {
+            for (index = next_tile + ringer->hold_remaining; index < next_end;
+                 index += prefetch_stride)
+                __builtin_prefetch(ringer->Input[channel] + index, 0, 0);
+
+            stream_samples(ringer->Output[channel] + start,
+                           tile_pointers[channel], length);
+        }
+    }
+
+    stream_fence();
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Does everything run(), run_adding() and ringer_run_events() have in
+ * common: checks for bad data, fires the tracepoints, times the block for the
+ * DSP load plugin, and runs the hold loop (streaming the output for huge run()
+ * blocks, unless there are copy count changes in 'events').
+ *
+ * NOTE: this is inlined into its callers with 'adding' as a constant.
+ */
+static inline void process_Ringer(LADSPA_Handle instance,
+                                  unsigned long sample_count, int adding,
+                                  const Ringer_parameter_event * events,
+                                  unsigned long event_count)
+{
+    Ringer * ringer = (Ringer *) instance;
+
+    /*
+     * NOTE: these special cases should never happen, but you never know--like
+     * if someone is developing a host program and it has some bugs in it, it
+     * might pass some bad data.  They are recorded as diagnostic events (see
+     * sb_ringer.h) rather than printed, since this runs on the audio thread.
+     */
+    if (sample_count == 0)
+    {
+        push_event(RINGER_EVENT_NO_SAMPLES, instance, sample_count);
+        return;
+    }
+    if (!ringer)
+    {
+        push_event(RINGER_EVENT_NULL_INSTANCE, instance, sample_count);
+        return;
+    }
+
+    // start timing the block right away if this is the DSP load plugin
+    const int measure_load = ringer->flags & RINGER_LOAD_PORTS;
+    const unsigned long long start_ticks = measure_load ? read_clock() : 0;
+
+    // set the number of copies to be made using the defined macro
+    const int SAMPLE_COPY_COUNT =
+            LIMIT_BETWEEN_5_AND_200((int) *(ringer->copy_count));
+
+    // whether the copy count is an audio-rate buffer instead of a single
+    // control value
+    const int audio_rate_copies = ringer->flags & RINGER_AUDIO_RATE_COPIES;
+
+    // work out the bitcrushed plugin's settings for this block
+    Ringer_crush crush_settings;
+    const Ringer_crush * crush = NULL;
+    if (ringer->flags & RINGER_CRUSH_PORTS)
+    {
+        int bits = (int) *(ringer->bits);
+        if (bits < MIN_BITS)
+            bits = MIN_BITS;
+        else if (bits > MAX_BITS)
+            bits = MAX_BITS;
+
+        // 2^(bits - 1) steps between 0 and 1 (the other bit is the sign)
+        crush_settings.steps = (LADSPA_Data) (1L << (bits - 1));
+        crush_settings.output_scale = powf(10.0f, *(ringer->gain) / 20.0f)
+                / crush_settings.steps;
+        crush = &crush_settings;
+    }
+
+    // whether the band-limited plugin's band-limiting is turned on (when it
+    // gets turned off, the corrections that were still to come are dropped)
+    Ringer_steps * steps = NULL;
+    if (ringer->flags & RINGER_BAND_LIMITED)
+    {
+        Ringer_band_limited * band_limited = ringer->band_limited;
+
+        if (*(band_limited->mode) > 0.0f)
+            steps = &band_limited->steps;
+        else if (band_limited->band_limiting)
+            memset(&band_limited->steps, 0, sizeof (Ringer_steps));
+        band_limited->band_limiting = steps != NULL;
+    }
+
+    // and the fractional plugin's hold length (in 16.16 fixed point)
+    unsigned long * fraction_state = NULL;
+    unsigned long hold_step = 0;
+    if (ringer->flags & RINGER_FRACTIONAL_COPIES)
+    {
+        fraction_state = &ringer->hold_fraction;
+        hold_step = to_hold_step(*(ringer->copy_count));
+    }
+
+    /*
+     * probe arguments: instance, block size, copy count (for the audio-rate
+     * plugin, the copy count at the first sample of the block).  The probe
+     * names have to be literal, hence the if; it disappears when this is
+     * inlined.
+     */
+    if (adding)
+        RINGER_PROBE3(run_adding_entry, ringer, sample_count,
+                      SAMPLE_COPY_COUNT);
+    else
+        RINGER_PROBE3(run_entry, ringer, sample_count, SAMPLE_COPY_COUNT);
+
+    if (!events && !adding
+        && sample_count >= __atomic_load_n(&streaming_threshold,
+                                           __ATOMIC_RELAXED))
+        stream_block(ringer, SAMPLE_COPY_COUNT, crush, steps, fraction_state,
+                     hold_step, sample_count);
+    else
+        hold_block(ringer->channel_count, ringer->held_samples,
+                   &ringer->hold_remaining, ringer->run_adding_gain,
+                   ringer->Input, ringer->Output,
+                   audio_rate_copies ? ringer->copy_count : NULL,
+                   SAMPLE_COPY_COUNT, events, event_count, crush, steps,
+                   fraction_state, hold_step, sample_count, adding, 0);
+
+    // report how much of the time this block lasts was spent processing it
+    if (measure_load)
+    {
+        const LADSPA_Data load = (LADSPA_Data)
+                ((read_clock() - start_ticks) * ringer->load_scale
+                 / sample_count);
+
+        if (load > ringer->peak_load_value)
+            ringer->peak_load_value = load;
+        if (ringer->load)
+            *(ringer->load) = load;
+        if (ringer->peak_load)
+            *(ringer->peak_load) = ringer->peak_load_value;
+    }
+
+    if (adding)
+        RINGER_PROBE3(run_adding_exit, ringer, sample_count,
+                      SAMPLE_COPY_COUNT);
+    else
+        RINGER_PROBE3(run_exit, ringer, sample_count, SAMPLE_COPY_COUNT);
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Fills the output buffers with the held input samples.
+ */
+void run_Ringer(LADSPA_Handle instance, unsigned long sample_count)
+{
+    process_Ringer(instance, sample_count, 0, NULL, 0);
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Same as run_Ringer(), except the held samples are scaled by the run_adding
+ * gain and added to what is already in the output buffers.  This lets the
+ * host mix the plugin straight onto a bus instead of running it into a scratch
+ * buffer and summing that afterwards.
+ */
+void run_adding_Ringer(LADSPA_Handle instance, unsigned long sample_count)
+{
+    process_Ringer(instance, sample_count, 1, NULL, 0);
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * See sb_ringer.h.
+ */
+void ringer_run_events(LADSPA_Handle instance, unsigned long sample_count,
+                       const Ringer_parameter_event * events,
+                       unsigned long event_count)
+{
+    process_Ringer(instance, sample_count, 0, events, event_count);
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Part of buffers_overlap(): sorts 'count' buffer addresses (and the
+ * instances they belong to along with them) into ascending order.  They are
+ * usually nearly in order already, so an insertion sort does fine.
+ */
+static void sort_buffers(uintptr_t * starts, unsigned char * owners,
+                         unsigned long count)
+{
+    unsigned long sorted;
+    unsigned long index;
+
+    for (sorted = 1; sorted < count; ++sorted)
+    {
+        const uintptr_t start = starts[sorted];
+        const unsigned char owner = owners[sorted];
+
+        for (index = sorted; index > 0 && starts[index - 1] > start; --index)
+        {
+            starts[index] = starts[index - 1];
+            owners[index] = owners[index - 1];
+        }
+        starts[index] = start;
+        owners[index] = owner;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Part of ringer_run_batch(): says whether any of the 'instance_count'
+ * instances reads or writes a buffer that another one of them writes, e.g.
+ * because they are chained (one instance's output is the next one's input)
+ * or mixed into the same output.  A group is run in one pass at the position
+ * of its first member, so grouping those would change the order the buffers
+ * are read and written in.  An instance working in place (reading and
+ * writing the same buffer itself) is fine.  All the buffers are
+ * 'sample_count' samples long.
+ *
+ * This is done on every call, so it has to be quick.  Usually the host has
+ * allocated the outputs one after the other and the inputs are somewhere
+ * else, which a first pass spots without storing anything.  Otherwise the
+ * buffers that are read and the ones that are written are each sorted by
+ * address and then walked through side by side, like merging two sorted
+ * lists, rather than comparing every buffer with every other one.
+ */
+static int buffers_overlap(LADSPA_Handle * instances,
+                           unsigned long instance_count,
+                           unsigned long sample_count)
+{
+    // (the audio-rate plugin reads its copy counts from a buffer too)
+    uintptr_t reads[BATCH_WINDOW * (MAX_CHANNELS + 1)];
+    unsigned char readers[BATCH_WINDOW * (MAX_CHANNELS + 1)];
+    uintptr_t writes[BATCH_WINDOW * MAX_CHANNELS];
+    unsigned char writers[BATCH_WINDOW * MAX_CHANNELS];
+    const uintptr_t length = sample_count * sizeof (LADSPA_Data);
+    uintptr_t lowest_read = UINTPTR_MAX;
+    uintptr_t highest_read = 0;
+    uintptr_t lowest_write = UINTPTR_MAX;
+    uintptr_t last_write_end = 0;
+    int in_order = 1;
+    unsigned long read_count = 0;
+    unsigned long write_count = 0;
+    unsigned long instance;
+    unsigned long channel;
+    unsigned long index;
+    unsigned long first_write;
+
+    // the first pass: are the outputs in order without overlapping, and are
+    // all the inputs (apart from in-place ones) below or above all of them?
+    for (instance = 0; instance < instance_count; ++instance)
+    {
+        const Ringer * ringer = (const Ringer *) instances[instance];
+        if (!ringer)
+            continue;
+
+        for (channel = 0; channel < ringer->channel_count; ++channel)
+        {
+            const uintptr_t read = (uintptr_t) ringer->Input[channel];
+            const uintptr_t write = (uintptr_t) ringer->Output[channel];
+
+            in_order &= write >= last_write_end;
+            last_write_end = write + length;
+            lowest_write = write < lowest_write ? write : lowest_write;
+            // an input that is the same buffer as its own output can only
+            // overlap another instance's output if the outputs overlap
+            if (read != write)
+            {
+                lowest_read = read < lowest_read ? read : lowest_read;
+                highest_read = read > highest_read ? read : highest_read;
+            }
+        }
+        if (ringer->flags & RINGER_AUDIO_RATE_COPIES)
+            in_order = 0;
+    }
+    if (in_order && (lowest_read == UINTPTR_MAX
+                     || highest_read + length <= lowest_write
+                     || lowest_read >= last_write_end))
+        return 0;
+
+    // the second pass, for everything else
+    for (instance = 0; instance < instance_count; ++instance)
+    {
+        const Ringer * ringer = (const Ringer *) instances[instance];
+        if (!ringer)
+            continue;
+
+        for (channel = 0; channel < ringer->channel_count; ++channel)
+        {
+            if (ringer->Input[channel] != ringer->Output[channel])
+            {
+                reads[read_count] = (uintptr_t) ringer->Input[channel];
+                readers[read_count++] = (unsigned char) instance;
+            }
+            writes[write_count] = (uintptr_t) ringer->Output[channel];
+            writers[write_count++] = (unsigned char) instance;
+        }
+        if (ringer->flags & RINGER_AUDIO_RATE_COPIES)
+        {
+            reads[read_count] = (uintptr_t) ringer->copy_count;
+            readers[read_count++] = (unsigned char) instance;
+        }
+    }
+
+    sort_buffers(reads, readers, read_count);
+    sort_buffers(writes, writers, write_count);
+
+    // since the buffers are all the same length, if two outputs of different
+    // instances overlap then so do two neighbouring ones
+    for (index = 1; index < write_count; ++index)
+        if (writes[index] < writes[index - 1] + length
+            && writers[index] != writers[index - 1])
+            return 1;
+
+    // for each input, skip the outputs that end before it starts and then
+    // check the ones that start before it ends
+    first_write = 0;
+    for (index = 0; index < read_count; ++index)
+    {
+        unsigned long other;
+
+        while (first_write < write_count
+               && writes[first_write] + length <= reads[index])
+            ++first_write;
+        for (other = first_write;
+             other < write_count && writes[other] < reads[index] + length;
+             ++other)
+            if (writers[other] != readers[index])
+                return 1;
+    }
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * See sb_ringer.h.  Instances with the same copy count that are at the same
+ * point in their holds have their holds start and end on the same samples, so
+ * they can be run as if they were the channels of one big instance: one pass
+ * through hold_block() works out the holds once and picks the fill kernel
+ * once for all of them.
+ *
+ * The instances are looked at BATCH_WINDOW at a time, so everything fits in
+ * fixed arrays on the stack (there's no allocating on the audio thread).
+ * Instances that can't be grouped (the audio-rate, DSP load, bitcrushed,
+ * fractional and band-limited plugins, and blocks long enough to be
+ * streamed) and bad calls just go through run().  So does the whole window
+ * if some of its instances share buffers (see buffers_overlap()), so they
+ * run in the order they were given.
+ */
+void ringer_run_batch(LADSPA_Handle * instances, unsigned long instance_count,
+                      unsigned long sample_count)
+{
+    LADSPA_Data * inputs[BATCH_WINDOW * MAX_CHANNELS];
+    LADSPA_Data * outputs[BATCH_WINDOW * MAX_CHANNELS];
+    LADSPA_Data held_samples[BATCH_WINDOW * MAX_CHANNELS];
+    Ringer * members[BATCH_WINDOW];
+    char done[BATCH_WINDOW];
+    unsigned long window;
+    unsigned long first;
+    unsigned long other;
+    unsigned long channel;
+
+    RINGER_PROBE3(run_batch_entry, instances, instance_count, sample_count);
+
+    for (window = 0; window < instance_count; window += BATCH_WINDOW)
+    {
+        unsigned long window_size = instance_count - window;
+        if (window_size > BATCH_WINDOW)
+            window_size = BATCH_WINDOW;
+        LADSPA_Handle * batch = instances + window;
+        const int chained = sample_count > 0
+                && buffers_overlap(batch, window_size, sample_count);
+
+        memset(done, 0, sizeof (done));
+
+        for (first = 0; first < window_size; ++first)
+        {
+            Ringer * ringer = (Ringer *) batch[first];
+
+            if (done[first])
+                continue;
+            done[first] = 1;
+
+            // the ones that can't be grouped
+            if (!ringer || sample_count == 0 || chained
+                || (ringer->flags & (RINGER_AUDIO_RATE_COPIES
+                                     | RINGER_LOAD_PORTS
+                                     | RINGER_CRUSH_PORTS
+                                     | RINGER_FRACTIONAL_COPIES
+                                     | RINGER_BAND_LIMITED))
+                || sample_count >= __atomic_load_n(&streaming_threshold,
+                                                   __ATOMIC_RELAXED))
+            {
+                process_Ringer(ringer, sample_count, 0, NULL, 0);
+                continue;
+            }
+
+            // this instance starts a new group; find the rest of it
+            const int copy_count =
+                    LIMIT_BETWEEN_5_AND_200((int) *(ringer->copy_count));
+            unsigned long hold_remaining = ringer->hold_remaining;
+            unsigned long member_count = 0;
+            unsigned long channel_count = 0;
+
+            for (other = first; other < window_size; ++other)
+            {
+                Ringer * member = (Ringer *) batch[other];
+
+                if (other != first
+                    && (done[other] || !member
+                        || (member->flags & (RINGER_AUDIO_RATE_COPIES
+                                             | RINGER_LOAD_PORTS
+                                             | RINGER_CRUSH_PORTS
+                                             | RINGER_FRACTIONAL_COPIES
+                                             | RINGER_BAND_LIMITED))
+                        || member->hold_remaining != hold_remaining
+                        || LIMIT_BETWEEN_5_AND_200(
+                                (int) *(member->copy_count)) != copy_count))
+                    continue;
+
+                done[other] = 1;
+                members[member_count++] = member;
+                for (channel = 0; channel < member->channel_count; ++channel)
+                {
+                    inputs[channel_count] = member->Input[channel];
+                    outputs[channel_count] = member->Output[channel];
+                    held_samples[channel_count] =
+                            member->held_samples[channel];
+                    ++channel_count;
+                }
+            }
+
+            hold_block(channel_count, held_samples, &hold_remaining, 1.0f,
+                       inputs, outputs, NULL, copy_count, NULL, 0, NULL,
+                       NULL, NULL, 0, sample_count, 0, 1);
+
+            // give every member its new hold state
+            channel_count = 0;
+            for (other = 0; other < member_count; ++other)
+            {
+                members[other]->hold_remaining = hold_remaining;
+                for (channel = 0; channel < members[other]->channel_count;
+                     ++channel)
+                    members[other]->held_samples[channel] =
+                            held_samples[channel_count++];
+            }
+        }
+    }
+
+    RINGER_PROBE3(run_batch_exit, instances, instance_count, sample_count);
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Sets the gain run_adding_Ringer() applies to its output.
+ */
+void set_run_adding_gain_Ringer(LADSPA_Handle instance, LADSPA_Data gain)
+{
+    ((Ringer *) instance)->run_adding_gain = gain;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Gives the plugin instance's memory back to the instance pool.  The host
+ * better send the right pointer in or there's gonna be a leak!
+ */
+void cleanup_Ringer(LADSPA_Handle instance)
+{
+    if (instance)
+    {
+        free(((Ringer *) instance)->band_limited);
+        free_instance((Ringer *) instance);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * See sb_ringer.h.
+ */
+void ringer_set_streaming_threshold(unsigned long sample_count)
+{
+    __atomic_store_n(&streaming_threshold,
+                     sample_count ? sample_count : ~0UL, __ATOMIC_RELAXED);
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * See sb_ringer.h.
+ */
+int ringer_use_kernels(int kernels)
+{
+    const int isa = kernels & ~RINGER_KERNELS_GENERIC_HOLDS;
+    int supported = (isa == RINGER_KERNELS_BEST
+                     || isa == RINGER_KERNELS_SCALAR);
+
+#ifdef RINGER_X86
+    __builtin_cpu_init();
+
+    if (isa == RINGER_KERNELS_SSE2)
+        supported = __builtin_cpu_supports("sse2");
+    else if (isa == RINGER_KERNELS_AVX2)
+        supported = __builtin_cpu_supports("avx2");
+    else if (isa == RINGER_KERNELS_AVX512)
+        supported = __builtin_cpu_supports("avx512f");
+#endif
+
+    if (supported)
+        select_fill_kernels(kernels);
+    return supported;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * See sb_ringer.h.  Every run is copy_count long except maybe the last one.
+ */
+unsigned long ringer_encode_runs(const LADSPA_Data * input,
+                                 unsigned long sample_count, int copy_count,
+                                 Ringer_run * runs)
+{
+    const unsigned long length = LIMIT_BETWEEN_5_AND_200(copy_count);
+    unsigned long index;
+    unsigned long count = 0;
+
+    for (index = 0; index < sample_count; index += length)
+    {
+        runs[count].value = input[index];
+        runs[count].length = (sample_count - index < length)
+                             ? sample_count - index : length;
+        ++count;
+    }
+
+    return count;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * See sb_ringer.h.
+ */
+unsigned long ringer_decimate(const LADSPA_Data * input,
+                              unsigned long sample_count, int copy_count,
+                              LADSPA_Data * values)
+{
+    const unsigned long length = LIMIT_BETWEEN_5_AND_200(copy_count);
+    unsigned long index;
+    unsigned long count = 0;
+
+    for (index = 0; index < sample_count; index += length)
+        values[count++] = input[index];
+
+    return count;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * See sb_ringer.h.
+ */
+void ringer_expander_init_runs(Ringer_expander * expander,
+                               const Ringer_run * runs, unsigned long count)
+{
+    memset(expander, 0, sizeof (Ringer_expander));
+    expander->runs = runs;
+    expander->count = count;
+}
 
-        free(Ringer_descriptor);
+void ringer_expander_init_values(Ringer_expander * expander,
+                                 const LADSPA_Data * values,
+                                 unsigned long count, int copy_count,
+                                 unsigned long sample_count)
+{
+    memset(expander, 0, sizeof (Ringer_expander));
+    expander->values = values;
+    expander->count = count;
+    expander->copy_count = LIMIT_BETWEEN_5_AND_200(copy_count);
+    expander->sample_count = sample_count;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * See sb_ringer.h.  Each run (or value) is written with the same fill kernels
+ * run() uses.
+ */
+unsigned long ringer_expand(Ringer_expander * expander, LADSPA_Data * output,
+                            unsigned long sample_count)
+{
+    unsigned long written = 0;
+
+    while (written < sample_count && expander->index < expander->count)
+    {
+        LADSPA_Data value;
+        unsigned long length;
+
+        if (expander->runs)
+        {
+            value = expander->runs[expander->index].value;
+            length = expander->runs[expander->index].length;
+        }
+        else
+        {
+            // the last value only covers whatever is left of the samples
+            const unsigned long start =
+                    expander->index * expander->copy_count;
+
+            if (start >= expander->sample_count)
+                break;
+
+            value = expander->values[expander->index];
+            length = (expander->sample_count - start < expander->copy_count)
+                     ? expander->sample_count - start : expander->copy_count;
+        }
+
+        // write what's left of this run, or as much as fits
+        unsigned long copies = length - expander->offset;
+        if (copies > sample_count - written)
+            copies = sample_count - written;
+
+        if (expander->offset == 0 && copies == length
+            && length <= MAX_COPIES)
+            hold_kernels[length](output + written, value, copies);
+        else
+            fill_samples(output + written, value, copies);
+
+        written += copies;
+        expander->offset += copies;
+        if (expander->offset == length)
+        {
+            ++expander->index;
+            expander->offset = 0;
+        }
+    }
+
+    return written;
+}
+
+//-----------------------------------------------------------------------------
+
+/*
+ * See sb_ringer.h.
+ */
+void ringer_pcm_reset(Ringer_pcm_state * state)
+{
+    state->held = 0;
+    state->hold_remaining = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * See sb_ringer.h.  This is the same hold loop as run()'s, on 16-bit
+ * samples.
+ */
+void ringer_run_int16(Ringer_pcm_state * state, const int16_t * input,
+                      int16_t * output, unsigned long sample_count,
+                      int copy_count)
+{
+    unsigned long index = 0;
+    unsigned long hold_remaining = state->hold_remaining;
+
+    copy_count = LIMIT_BETWEEN_5_AND_200(copy_count);
+
+    while (index < sample_count)
+    {
+        if (hold_remaining == 0)
+        {
+            state->held = input[index];
+            hold_remaining = copy_count;
+        }
+
+        unsigned long copies = sample_count - index;
+        if (copies > hold_remaining)
+            copies = hold_remaining;
+
+        fill_int16(output + index, (int16_t) state->held, copies);
+
+        index += copies;
+        hold_remaining -= copies;
+    }
+
+    state->hold_remaining = hold_remaining;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * See sb_ringer.h.  The held sample is kept as its 3 bytes, in the order
+ * they are in memory, since it is only ever copied.
+ */
+void ringer_run_int24(Ringer_pcm_state * state, const unsigned char * input,
+                      unsigned char * output, unsigned long sample_count,
+                      int copy_count)
+{
+    unsigned long index = 0;
+    unsigned long hold_remaining = state->hold_remaining;
+
+    copy_count = LIMIT_BETWEEN_5_AND_200(copy_count);
+
+    while (index < sample_count)
+    {
+        if (hold_remaining == 0)
+        {
+            const unsigned char * sample = input + 3 * index;
+
+            state->held = sample[0] | (sample[1] << 8)
+                          | ((uint32_t) sample[2] << 16);
+            hold_remaining = copy_count;
+        }
+
+        unsigned long copies = sample_count - index;
+        if (copies > hold_remaining)
+            copies = hold_remaining;
+
+        fill_int24(output + 3 * index, (uint32_t) state->held, copies);
+
+        index += copies;
+        hold_remaining -= copies;
+    }
+
+    state->hold_remaining = hold_remaining;
+}
+
+//-----------------------------------------------------------------------------
+
+/*
+ * The plugins in this library.  The mono one is the original Ringer; the rest
+ * process several channels with one instance, using one copy count control
+ * and one shared hold for all of them so the channels stay phase-locked.
+ *
+ * After those there is a mono Ringer whose copy count comes from an audio
+ * port, so the hold length can be modulated at audio rate, and a mono Ringer
+ * with two output controls that show how much CPU it is using (as a
+ * percentage of the real-time budget for each block, and the peak of that).
+ * Then there is a mono Ringer with a bitcrusher and a gain control built in,
+ * which costs next to nothing extra since only the held samples need crushing,
+ * a mono Ringer whose copy count doesn't have to be a whole number (5.5
+ * copies alternates between holds of 5 and 6 samples, and so on), and last a
+ * mono Ringer that can smooth out the steps between its holds (see
+ * BAND-LIMITED STEPS above).
+ *
+ * NOTE: the other plugins' IDs follow on from the mono plugin's ID.  Only
+ * the mono plugin's ID (4303) was given by Richard Furse; 4304 to 4312 have
+ * NOT been allocated to Ringer by anyone.  They are a provisional block,
+ * reserved for these plugins in this file only, and have to be requested
+ * from ladspa@muse.demon.co.uk (and this note replaced with where they were
+ * registered) before the library is released with them, as another plugin
+ * might already be using them.  Until then, keep the order of this table, so
+ * saved host sessions still find the same plugins.
+ * The 5.1 channel order is the usual WAV/SMPTE one (L R C LFE Ls Rs).
+ */
+static const Ringer_variant Ringer_variants[DESCRIPTOR_COUNT] =
+{
+    { UNIQUE_ID, "Ringer", "Ringer", 1, { NULL }, 0 },
+    { UNIQUE_ID + 1, "Ringer_Stereo", "Ringer (stereo)", 2,
+      { "L", "R" }, 0 },
+    { UNIQUE_ID + 2, "Ringer_Quad", "Ringer (quad)", 4,
+      { "FL", "FR", "RL", "RR" }, 0 },
+    { UNIQUE_ID + 3, "Ringer_5_1", "Ringer (5.1)", 6,
+      { "L", "R", "C", "LFE", "Ls", "Rs" }, 0 },
+    { UNIQUE_ID + 4, "Ringer_8ch", "Ringer (8 channel)", 8,
+      { "1", "2", "3", "4", "5", "6", "7", "8" }, 0 },
+    { UNIQUE_ID + 5, "Ringer_Modulated", "Ringer (audio-rate copies)", 1,
+      { NULL }, RINGER_AUDIO_RATE_COPIES },
+    { UNIQUE_ID + 6, "Ringer_Load", "Ringer (with DSP load)", 1,
+      { NULL }, RINGER_LOAD_PORTS },
+    { UNIQUE_ID + 7, "Ringer_Crush", "Ringer (bitcrushed)", 1,
+      { NULL }, RINGER_CRUSH_PORTS },
+    { UNIQUE_ID + 8, "Ringer_Fractional", "Ringer (fractional copies)", 1,
+      { NULL }, RINGER_FRACTIONAL_COPIES },
+    { UNIQUE_ID + 9, "Ringer_BandLimited", "Ringer (band-limited)", 1,
+      { NULL }, RINGER_BAND_LIMITED }
+};
+
+
+/*
+ * Global LADSPA_Descriptor array used in _init(), ladspa_descriptor(),
+ * and _fini().  It holds a descriptor for each of the plugins above that
+ * could be built, in the same order, and then NULLs.
+ */
+LADSPA_Descriptor * Ringer_descriptors[DESCRIPTOR_COUNT] = { NULL };
+
+
+/*
+ * Makes a port name out of a base name and a channel name, like
+ * "Input (L)".  Mono plugins (with no channel name) just get the base name.
+ */
+static char * make_port_name(const char * base, const char * channel_name)
+{
+    char * name;
+
+    if (!channel_name)
+        return strdup(base);
+
+    name = (char *) malloc(strlen(base) + strlen(channel_name) + 4);
+    if (name)
+        sprintf(name, "%s (%s)", base, channel_name);
+    return name;
+}
+
+
+/*
+ * Frees a descriptor made by create_descriptor() and everything in it (any
+ * of which can be NULL).
+ */
+static void free_descriptor(LADSPA_Descriptor * descriptor)
+{
+    unsigned long port;
+
+    free((char *) descriptor->Label);
+    free((char *) descriptor->Name);
+    free((char *) descriptor->Maker);
+    free((char *) descriptor->Copyright);
+    free((LADSPA_PortDescriptor *) descriptor->PortDescriptors);
+
+    if (descriptor->PortNames)
+        for (port = 0; port < descriptor->PortCount; ++port)
+            free((char *) (descriptor->PortNames[port]));
+
+    free((char **) descriptor->PortNames);
+    free((LADSPA_PortRangeHint *) descriptor->PortRangeHints);
+
+    free(descriptor);
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Creates and fills in the LADSPA_Descriptor for one of the plugins.  Returns
+ * NULL if malloc fails.
+ */
+static LADSPA_Descriptor * create_descriptor(const Ringer_variant * variant)
+{
+    LADSPA_Descriptor * descriptor;
+    const unsigned long channel_count = variant->channel_count;
+    const unsigned long port_count = 1 + 2 * channel_count
+            + ((variant->flags & (RINGER_LOAD_PORTS | RINGER_CRUSH_PORTS))
+               ? 2 : 0)
+            + ((variant->flags & RINGER_BAND_LIMITED) ? 1 : 0);
+    unsigned long channel;
+
+    /*
+     * allocate memory for the descriptor.
+     * In other words create an actual LADSPA_Descriptor struct instance that
+     * the descriptor pointer will point to.
+     */
+    descriptor = (LADSPA_Descriptor *) malloc(sizeof (LADSPA_Descriptor));
+
+    // make sure malloc worked properly before initializing the struct fields
+    if (!descriptor)
+        return NULL;
+
+    // assign the unique ID of the plugin
+    descriptor->UniqueID = variant->unique_id;
+
+    /*
+     * assign the label of the plugin. (NOTE: it must not have white
+     * spaces as per ladspa.h).
+     * NOTE: in case you were wondering, strdup() from the string library
+     * makes a duplicate string of the argument and returns the duplicate's
+     * pointer (a char *).
+     */
+    descriptor->Label = strdup(variant->label);
+
+    /*
+     * assign the special property of the plugin, which is any of the three
+     * defined in ladspa.h: LADSPA_PROPERTY_REALTIME,
+     * LADSPA_PROPERTY_INPLACE_BROKEN, and LADSPA_PROPERTY_HARD_RT_CAPABLE.
+     * They are just ints (1, 2, and 4, respectively).  See ladspa.h for
+     * what they actually mean.
+     *
+     * NOTE: LADSPA_PROPERTY_INPLACE_BROKEN is deliberately left out -- the
+     * plugin works in place (see the top of the file), so hosts don't need to
+     * give it a separate output buffer.
+     */
+    descriptor->Properties = LADSPA_PROPERTY_HARD_RT_CAPABLE;
+
+    // assign the plugin name
+    descriptor->Name = strdup(variant->name);
+
+    // assign the author of the plugin
+    descriptor->Maker = strdup("Tyler Hayes (tgh@pdx.edu)");
+
+    /*
+     * assign the copyright info of the plugin (NOTE: use "None" for no
+     * copyright as per ladspa.h)
+     */
+    descriptor->Copyright = strdup("GPL");
+
+    // assign the number of ports for the plugin.
+    descriptor->PortCount = port_count;
+
+    /*
+     * used for allocating and initailizing a LADSPA_PortDescriptor array
+     * (which is an array of ints) since descriptor->PortDescriptors
+     * is a const *.
+     */
+    LADSPA_PortDescriptor * temp_descriptor_array;
+
+    // allocate space for the temporary array with a length of the number
+    // of ports (PortCount)
+    temp_descriptor_array = (LADSPA_PortDescriptor *)
+            calloc(port_count, sizeof (LADSPA_PortDescriptor));
+
+    /*
+     * set the instance LADSPA_PortDescriptor array (PortDescriptors)
+     * pointer to the location temp_descriptor_array is pointing at.
+     */
+    descriptor->PortDescriptors = (const LADSPA_PortDescriptor *)
+            temp_descriptor_array;
+
+    /*
+     * temporary local variable (which is a pointer to an array of arrays
+     * of characters) for the names of the ports since descriptor->
+     * PortNames is a const char * const *.
+     */
+    char ** temp_port_names;
+
+    // allocate the space for the port names
+    temp_port_names = (char **) calloc(port_count, sizeof (char *));
+
+    /*
+     * set the instance PortNames array pointer to the location
+     * temp_port_names is pointing at.
+     */
+    descriptor->PortNames = (const char **) temp_port_names;
+
+    /*
+     * temporary local variable (pointerto a PortRangeHint struct) since
+     * descriptor->PortRangeHints is a const *.
+     */
+    LADSPA_PortRangeHint * temp_hints;
+
+    // allocate space for the port hints (see ladspa.h for info on 'hints')
+    temp_hints = (LADSPA_PortRangeHint *)
+            calloc(port_count, sizeof (LADSPA_PortRangeHint));
+
+    /*
+     * set the instance PortRangeHints pointer to the location temp_hints
+     * is pointed at.
+     */
+    descriptor->PortRangeHints = (const LADSPA_PortRangeHint *) temp_hints;
+
+    // bail out if any of the arrays couldn't be allocated.  The host mustn't
+    // get a descriptor with its function pointers not set, so there is no
+    // descriptor for this plugin at all then.
+    if (!temp_descriptor_array || !temp_port_names || !temp_hints)
+    {
+        free_descriptor(descriptor);
+        return NULL;
+    }
+
+    /*
+     * set the port properties by ORing specific bit masks defined in
+     * ladspa.h.
+     *
+     * this one gives the control port that defines the number of sample
+     * copies the properties that tell the host that this port takes input
+     * (from the user) and is a control port (a port that is controlled by
+     * the user).
+     */
+    if (variant->flags & RINGER_AUDIO_RATE_COPIES)
+    {
+        // the audio-rate plugin gets its copy count from an audio port
+        temp_descriptor_array[RINGER_COPY_COUNT] = LADSPA_PORT_INPUT |
+                LADSPA_PORT_AUDIO;
+        temp_port_names[RINGER_COPY_COUNT] = strdup("Copies (audio rate)");
+    }
+    else
+    {
+        temp_descriptor_array[RINGER_COPY_COUNT] = LADSPA_PORT_INPUT |
+                LADSPA_PORT_CONTROL;
+
+        // set the name of the control port for the number of sample copies
+        // to be made
+        temp_port_names[RINGER_COPY_COUNT] = strdup("Copies (samples)");
+    }
+
+    /*
+     * set the port hint descriptors (which are ints).
+     * For the control port, the BOUNDED masks from
+     * ladspa.h tell the host that this control has limits (this one is 5
+     * and 200 as defined in the Macro at the top).
+     * The DEFAULT_LOW mask tells the host to set the control value upon
+     * start (like for a gui) to a low value between the bounds.
+     * The INTEGER mask tells the host that the control values should be in
+     * integers.
+     */
+    temp_hints[RINGER_COPY_COUNT].HintDescriptor =
+            (LADSPA_HINT_BOUNDED_BELOW
+             | LADSPA_HINT_BOUNDED_ABOVE
+             | LADSPA_HINT_DEFAULT_LOW
+             | LADSPA_HINT_INTEGER);
+    // set the lower bound of the control
+    temp_hints[RINGER_COPY_COUNT].LowerBound = (LADSPA_Data) MIN_COPIES;
+    // set the upper bound of the control
+    temp_hints[RINGER_COPY_COUNT].UpperBound = (LADSPA_Data) MAX_COPIES;
+
+    // an audio port can't have a default value, so drop the DEFAULT_LOW mask
+    // for the audio-rate copy count
+    if (variant->flags & RINGER_AUDIO_RATE_COPIES)
+        temp_hints[RINGER_COPY_COUNT].HintDescriptor &=
+                ~LADSPA_HINT_DEFAULT_MASK;
+
+    // and the fractional copy count isn't limited to whole numbers
+    if (variant->flags & RINGER_FRACTIONAL_COPIES)
+        temp_hints[RINGER_COPY_COUNT].HintDescriptor &= ~LADSPA_HINT_INTEGER;
+
+    for (channel = 0; channel < channel_count; ++channel)
+    {
+        const unsigned long input_port = RINGER_INPUT + channel;
+        const unsigned long output_port = OUTPUT_PORT(channel, channel_count);
+
+        /*
+         * this one gives the input port the properties that tell the host
+         * that this port takes input and is an audio port (not a control
+         * port).
+         */
+        temp_descriptor_array[input_port] = LADSPA_PORT_INPUT |
+                LADSPA_PORT_AUDIO;
+
+        /*
+         * this gives the output port the properties that tell the host that
+         * this port is an output port and that it is an audio port.
+         */
+        temp_descriptor_array[output_port] = LADSPA_PORT_OUTPUT |
+                LADSPA_PORT_AUDIO;
+
+        // set the names of the input and output ports
+        temp_port_names[input_port] =
+                make_port_name("Input", variant->channel_names[channel]);
+        temp_port_names[output_port] =
+                make_port_name("Output", variant->channel_names[channel]);
+
+        // input and ouput don't need any range hints
+        temp_hints[input_port].HintDescriptor = 0;
+        temp_hints[output_port].HintDescriptor = 0;
+    }
+
+    /*
+     * the DSP load plugin (which is mono) also gets two output control ports,
+     * which the plugin writes to instead of reading from.  They can't go below
+     * 0%, but a block that took longer than its real-time budget goes over
+     * 100%, so there is no upper bound.
+     */
+    if (variant->flags & RINGER_LOAD_PORTS)
+    {
+        temp_descriptor_array[RINGER_LOAD] = LADSPA_PORT_OUTPUT |
+                LADSPA_PORT_CONTROL;
+        temp_descriptor_array[RINGER_PEAK_LOAD] = LADSPA_PORT_OUTPUT |
+                LADSPA_PORT_CONTROL;
+
+        temp_port_names[RINGER_LOAD] = strdup("DSP load (%)");
+        temp_port_names[RINGER_PEAK_LOAD] = strdup("Peak DSP load (%)");
+
+        temp_hints[RINGER_LOAD].HintDescriptor = LADSPA_HINT_BOUNDED_BELOW;
+        temp_hints[RINGER_LOAD].LowerBound = 0.0f;
+        temp_hints[RINGER_PEAK_LOAD].HintDescriptor =
+                LADSPA_HINT_BOUNDED_BELOW;
+        temp_hints[RINGER_PEAK_LOAD].LowerBound = 0.0f;
+    }
+
+    /*
+     * the bitcrushed plugin (also mono) gets two more input controls: the bit
+     * depth, which starts out at the most bits (so nothing is crushed until
+     * it's turned down), and the gain in dB, which starts out at 0 dB.
+     */
+    if (variant->flags & RINGER_CRUSH_PORTS)
+    {
+        temp_descriptor_array[RINGER_BITS] = LADSPA_PORT_INPUT |
+                LADSPA_PORT_CONTROL;
+        temp_descriptor_array[RINGER_GAIN] = LADSPA_PORT_INPUT |
+                LADSPA_PORT_CONTROL;
+
+        temp_port_names[RINGER_BITS] = strdup("Bit depth");
+        temp_port_names[RINGER_GAIN] = strdup("Gain (dB)");
+
+        temp_hints[RINGER_BITS].HintDescriptor =
+                (LADSPA_HINT_BOUNDED_BELOW
+                 | LADSPA_HINT_BOUNDED_ABOVE
+                 | LADSPA_HINT_DEFAULT_MAXIMUM
+                 | LADSPA_HINT_INTEGER);
+        temp_hints[RINGER_BITS].LowerBound = (LADSPA_Data) MIN_BITS;
+        temp_hints[RINGER_BITS].UpperBound = (LADSPA_Data) MAX_BITS;
+        temp_hints[RINGER_GAIN].HintDescriptor =
+                (LADSPA_HINT_BOUNDED_BELOW
+                 | LADSPA_HINT_BOUNDED_ABOVE
+                 | LADSPA_HINT_DEFAULT_0);
+        temp_hints[RINGER_GAIN].LowerBound = (LADSPA_Data) MIN_GAIN_DB;
+        temp_hints[RINGER_GAIN].UpperBound = (LADSPA_Data) MAX_GAIN_DB;
+    }
+
+    /*
+     * and the band-limited plugin (mono as well) gets an on/off control for
+     * the band-limiting, which starts out on.  Turned off, it is the same as
+     * the mono plugin.
+     */
+    if (variant->flags & RINGER_BAND_LIMITED)
+    {
+        temp_descriptor_array[RINGER_MODE] = LADSPA_PORT_INPUT |
+                LADSPA_PORT_CONTROL;
+        temp_port_names[RINGER_MODE] = strdup("Band-limited");
+        temp_hints[RINGER_MODE].HintDescriptor =
+                (LADSPA_HINT_TOGGLED | LADSPA_HINT_DEFAULT_1);
+    }
+
+    // let instantiate() know which plugin it's creating an instance of
+    descriptor->ImplementationData = (void *) variant;
+
+    // set the instance's function pointers to appropriate functions
+    descriptor->instantiate = instantiate_Ringer;
+    descriptor->connect_port = connect_port_to_Ringer;
+    descriptor->activate = activate_Ringer;
+    descriptor->run = run_Ringer;
+    descriptor->run_adding = run_adding_Ringer;
+    descriptor->set_run_adding_gain = set_run_adding_gain_Ringer;
+    descriptor->deactivate = deactivate_Ringer;
+    descriptor->cleanup = cleanup_Ringer;
+
+    return descriptor;
+}
+
+
+/*
+ * The _init() function is called whenever this plugin is first loaded
+ * by the host using it (when the host program is first opened).
+ */
+void _init()
+{
+    unsigned long i;
+    unsigned long built = 0;
+
+    // pick the kernels run() and run_adding() will use on this processor
+    select_fill_kernels(RINGER_KERNELS_BEST);
+
+    // work out the band-limited plugin's smooth steps
+    build_step_tables();
+
+    // get the first slab of instances ready before the host asks for any
+    // (if this fails, instantiate() will try again)
+    pthread_mutex_lock(&pool_lock);
+    if (!slabs)
+        grow_pool();
+    pthread_mutex_unlock(&pool_lock);
+
+    // create a descriptor for each of the plugins in the library, packing
+    // them together so that one that couldn't be built doesn't leave a NULL
+    // gap (hosts stop asking for descriptors at the first NULL)
+    for (i = 0; i < DESCRIPTOR_COUNT; ++i)
+    {
+        LADSPA_Descriptor * descriptor =
+                create_descriptor(&Ringer_variants[i]);
+
+        if (descriptor)
+            Ringer_descriptors[built++] = descriptor;
+    }
+    while (built < DESCRIPTOR_COUNT)
+        Ringer_descriptors[built++] = NULL;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * Returns a descriptor of this plugin.
+ *
+ * NOTE: this function MUST be called 'ladspa_descriptor' or else the plugin
+ * will not be recognized.
+ */
+const LADSPA_Descriptor * ladspa_descriptor(unsigned long index)
+{
+    if (index < DESCRIPTOR_COUNT)
+        return Ringer_descriptors[index];
+    else
+        return NULL;
+}
+
+//-----------------------------------------------------------------------------
+
+
+/*
+ * This is called automatically when the host quits (when this dynamic library
+ * is unloaded).  It frees all dynamically allocated memory associated with
+ * the descriptors and the instance pool.
+ */
+void _fini()
+{
+    unsigned long i;
+
+    for (i = 0; i < DESCRIPTOR_COUNT; ++i)
+    {
+        if (Ringer_descriptors[i])
+            free_descriptor(Ringer_descriptors[i]);
+        Ringer_descriptors[i] = NULL;
     }
+
+    destroy_pool();
 }
 
 // ------------------------------- EOF ----------------------------------------
@@ -0,0 +1,271 @@
+/*
+ * Copyright © 2009 Tyler Hayes
+ * ALL RIGHTS RESERVED
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file COPYING in the source
+ * distribution of this software for license terms.
+ *
+ * Extra functions exported by sb_ringer.so, for programs that link against
+ * the library directly instead of (or as well as) going through the LADSPA
+ * descriptor.
+ */
+
+#ifndef SB_RINGER_H
+#define SB_RINGER_H
+
+
+//----------------
+//-- INCLUSIONS --
+//----------------
+#include <stdint.h>
+#include <ladspa.h>
+
+
+//-----------------
+//-- DIAGNOSTICS --
+//-----------------
+/*
+ * run() never prints anything (console I/O on the audio thread would cause
+ * dropouts).  When it is handed bad data it records a Ringer_event instead,
+ * which a non real-time thread can pick up with ringer_read_events().
+ */
+
+// run() or run_adding() was called with a sample count of 0
+#define RINGER_EVENT_NO_SAMPLES 1
+// run() or run_adding() was called with a NULL instance
+#define RINGER_EVENT_NULL_INSTANCE 2
+
+
+typedef struct
+{
+    // one of the RINGER_EVENT_ codes above
+    int code;
+    // the instance and sample count run() was called with
+    const void * instance;
+    unsigned long sample_count;
+    // when it happened (CLOCK_MONOTONIC, in nanoseconds)
+    unsigned long long timestamp;
+} Ringer_event;
+
+
+/*
+ * Copies up to 'max_events' of the oldest unread events into 'events' and
+ * returns how many were copied.  Only one thread may read events at a time.
+ */
+unsigned long ringer_read_events(Ringer_event * events,
+                                 unsigned long max_events);
+
+/*
+ * Returns how many events were overwritten before they could be read (the
+ * event buffer only holds the most recent ones).
+ */
+unsigned long ringer_lost_events();
+
+
+//----------------------
+//-- BATCH PROCESSING --
+//----------------------
+/*
+ * Does the same as calling run() with 'sample_count' on each of the
+ * 'instance_count' instances (of any of the plugins in this library), but
+ * much faster for a lot of instances with small blocks: instances with the
+ * same copy count that were activated together are processed together in one
+ * pass.  The instances' ports have to be connected as usual first.
+ *
+ * The instances are run in the order given, so they can be chained (one
+ * instance's output connected to the next one's input) or share buffers in
+ * any other way, but then they are just run one at a time (in windows of 64
+ * instances), so they don't get any faster.
+ */
+void ringer_run_batch(LADSPA_Handle * instances, unsigned long instance_count,
+                      unsigned long sample_count);
+
+
+//----------------------
+//-- PARAMETER EVENTS --
+//----------------------
+/*
+ * A change of the copy count at sample 'frame' of a block.
+ */
+typedef struct
+{
+    unsigned long frame;
+    LADSPA_Data copy_count;
+} Ringer_parameter_event;
+
+
+/*
+ * Does the same as cutting the block up at each event's frame and calling
+ * run() on each piece, with the copy count port set to the event's value
+ * (starting with the port's value as it is now), but in one call.  A change
+ * takes effect on the first hold that starts at or after its frame; a hold
+ * that is already going keeps its length.  The events have to be sorted by
+ * frame.  The copy count port itself isn't changed, so the host should set it
+ * to the last event's value before the next run().  The audio-rate plugin
+ * ignores the events (its copy count port already is sample-accurate).
+ */
+void ringer_run_events(LADSPA_Handle instance, unsigned long sample_count,
+                       const Ringer_parameter_event * events,
+                       unsigned long event_count);
+
+
+//----------------------
+//-- STREAMING STORES --
+//----------------------
+/*
+ * Makes run() calls with at least this many samples write their output with
+ * non-temporal stores, which bypass the cache so that rendering a huge block
+ * doesn't evict every other plugin's data.  It's off by default (and when
+ * passed 0), since the stores are slower in their own right when the output
+ * would have fit in the cache anyway; try it with 'ringer-bench -p' first.
+ * This affects every instance in the process.
+ */
+void ringer_set_streaming_threshold(unsigned long sample_count);
+
+
+//-------------------
+//-- KERNEL CHOICE --
+//-------------------
+/*
+ * The plugin normally uses the fastest kernels (the loops that write the
+ * output) the processor supports.  ringer_use_kernels() makes it use the ones
+ * for an older instruction set instead, which is how the unit test checks
+ * that they all give exactly the same output, and how a benchmark can see
+ * what each one is worth.  It returns 0 (and changes nothing) if the
+ * processor doesn't support the instruction set.  This affects every
+ * instance in the process, so it must not be called while any of them might
+ * be running.
+ */
+
+// the fastest kernels the processor supports (what the plugin starts with)
+#define RINGER_KERNELS_BEST 0
+// plain C, on any processor
+#define RINGER_KERNELS_SCALAR 1
+// x86 only (SSE2 includes the SSSE3 kernel for 24-bit samples)
+#define RINGER_KERNELS_SSE2 2
+#define RINGER_KERNELS_AVX2 3
+#define RINGER_KERNELS_AVX512 4
+// OR'd into any of the above: use the generic kernel for every hold length,
+// leaving out the ones specialized for common hold lengths (so a benchmark
+// can see what those are worth)
+#define RINGER_KERNELS_GENERIC_HOLDS 0x100
+
+int ringer_use_kernels(int kernels);
+
+
+//---------------------------
+//-- RUN-LENGTH OUTPUT API --
+//---------------------------
+/*
+ * Ringer's output is, by construction, one input sample repeated copy_count
+ * times, then the next, and so on.  These functions produce that output in
+ * its compact form instead of writing out every copy: either as (value,
+ * length) runs, or as just the values (every copy_count'th input sample).
+ * A Ringer_expander turns either form back into the full output a piece at a
+ * time.
+ *
+ * They give the same result as a freshly activated mono Ringer run over the
+ * whole input, with copy_count clamped to 5..200 the same way.  To process a
+ * long input in pieces, make every piece but the last a multiple of
+ * copy_count long.
+ */
+
+typedef struct
+{
+    LADSPA_Data value;
+    unsigned long length;
+} Ringer_run;
+
+
+typedef struct
+{
+    // either runs or values is set, depending on how it was initialized
+    const Ringer_run * runs;
+    const LADSPA_Data * values;
+    // number of runs or values
+    unsigned long count;
+    // hold length for values, and the total number of samples they expand to
+    unsigned long copy_count;
+    unsigned long sample_count;
+    // current run/value and how many samples of it have been written
+    unsigned long index;
+    unsigned long offset;
+} Ringer_expander;
+
+
+/*
+ * Writes the runs Ringer would produce for 'input' into 'runs' and returns how
+ * many there are.  'runs' must have room for
+ * (sample_count + copy_count - 1) / copy_count of them.  The last run is
+ * shorter than copy_count if sample_count isn't a multiple of it.
+ */
+unsigned long ringer_encode_runs(const LADSPA_Data * input,
+                                 unsigned long sample_count, int copy_count,
+                                 Ringer_run * runs);
+
+/*
+ * Writes just the held values (input[0], input[copy_count], ...) into
+ * 'values' and returns how many there are (same count as for the runs).
+ */
+unsigned long ringer_decimate(const LADSPA_Data * input,
+                              unsigned long sample_count, int copy_count,
+                              LADSPA_Data * values);
+
+/*
+ * Sets up an expander to expand 'count' runs, or 'count' values that were
+ * decimated from 'sample_count' samples with 'copy_count'.  The runs/values
+ * aren't copied, so they have to stay around until the expander is done.
+ */
+void ringer_expander_init_runs(Ringer_expander * expander,
+                               const Ringer_run * runs, unsigned long count);
+void ringer_expander_init_values(Ringer_expander * expander,
+                                 const LADSPA_Data * values,
+                                 unsigned long count, int copy_count,
+                                 unsigned long sample_count);
+
+/*
+ * Writes the next (up to) 'sample_count' samples of the expanded output into
+ * 'output' and returns how many were written, which is less than
+ * 'sample_count' only when the end has been reached.
+ */
+unsigned long ringer_expand(Ringer_expander * expander, LADSPA_Data * output,
+                            unsigned long sample_count);
+
+
+//---------------------
+//-- INTEGER PCM API --
+//---------------------
+/*
+ * Ringer on 16-bit and packed 24-bit (3 bytes per sample) PCM, for programs
+ * that would otherwise convert their samples to floats, run the plugin and
+ * convert them back.  Ringer only copies samples, so the result is exactly
+ * what that would give, with a third of the memory traffic or less.  The
+ * samples can be in either byte order (they are copied as they are), and
+ * input and output can be the same buffer.
+ *
+ * The hold is carried from one call to the next in a Ringer_pcm_state, which
+ * has to be reset before the first call (like activate()).  copy_count is
+ * clamped to 5..200 the same way as the plugin's control.
+ */
+
+typedef struct
+{
+    // the sample being held (for 24-bit, its 3 bytes in memory order)
+    int32_t held;
+    // how many more copies of it are still to be made
+    unsigned long hold_remaining;
+} Ringer_pcm_state;
+
+
+void ringer_pcm_reset(Ringer_pcm_state * state);
+
+void ringer_run_int16(Ringer_pcm_state * state, const int16_t * input,
+                      int16_t * output, unsigned long sample_count,
+                      int copy_count);
+
+void ringer_run_int24(Ringer_pcm_state * state, const unsigned char * input,
+                      unsigned char * output, unsigned long sample_count,
+                      int copy_count);
+
+
+#endif // SB_RINGER_H
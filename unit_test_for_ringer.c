@@ -1,203 +1,1554 @@
 // Unit test driver for the run() function of sb_ringer.c
+//
+// This links against sb_ringer.so and runs the real plugin through
+// ladspa_descriptor().  It writes every output sample to the given file, checks
+// them against what Ringer is supposed to produce, and then runs the plugin
+// again in place (with the same buffer connected to the input and the output)
+// to make sure that gives exactly the same result.  The rest of the checks
+// compare the library's other entry points (see sb_ringer.h) with run().
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "../ladspa.h"
+#include <stdint.h>
+#include <time.h>
+#include <ladspa.h>
+#include "sb_ringer.h"
 
-#define LIMIT_BETWEEN_5_AND_500(x) (((x) < 5) ? 5 : (((x) > 500) ? 500 : (x)))
+#define LIMIT_BETWEEN_5_AND_200(x) (((x) < 5) ? 5 : (((x) > 200) ? 200 : (x)))
 
-void run_Ringer(LADSPA_Handle instance, unsigned long sample_count);
+// port numbers of the mono Ringer plugin
+#define RINGER_COPY_COUNT 0
+#define RINGER_INPUT 1
+#define RINGER_OUTPUT 2
+// the band-limited plugin's extra control port
+#define RINGER_MODE 3
 
 
-typedef struct
+/*
+ * Runs the mono plugin over 'input' into 'output' in blocks of 'block_size'
+ * samples.  Returns 0 if the plugin couldn't be instantiated.
+ */
+int run_plugin(LADSPA_Data * input, LADSPA_Data * output,
+               unsigned long sample_count, unsigned long block_size,
+               LADSPA_Data copy_count)
 {
-    LADSPA_Data * copy_count;
-    LADSPA_Data * Input;
-    LADSPA_Data * Output;
-} Ringer;
+    const LADSPA_Descriptor * descriptor = ladspa_descriptor(0);
+    LADSPA_Handle instance;
+    unsigned long index;
 
-char * filename;
+    if (!descriptor)
+        return 0;
+    instance = descriptor->instantiate(descriptor, 44100);
+    if (!instance)
+        return 0;
 
+    descriptor->connect_port(instance, RINGER_COPY_COUNT, &copy_count);
+    descriptor->activate(instance);
 
-int main(int argc, char * argv[])
+    for (index = 0; index < sample_count; index += block_size)
+    {
+        unsigned long length = sample_count - index;
+        if (length > block_size)
+            length = block_size;
+
+        descriptor->connect_port(instance, RINGER_INPUT, input + index);
+        descriptor->connect_port(instance, RINGER_OUTPUT, output + index);
+        descriptor->run(instance, length);
+    }
+
+    descriptor->deactivate(instance);
+    descriptor->cleanup(instance);
+    return 1;
+}
+
+
+// number of instances check_batch() runs
+#define BATCH_SIZE 8
+// the first BATCH_GROUPED of them don't share any buffers
+#define BATCH_GROUPED 5
+
+
+/*
+ * Runs BATCH_SIZE instances of the mono plugin over 'input' in blocks of 7
+ * samples, once one at a time with run() and once with ringer_run_batch(), and
+ * checks both ways give the same output.  Instances 0 to 2 have the same copy
+ * count, so they can be grouped, 3 has a different one and 4 is 3 samples
+ * into its hold when the others start theirs.  5 to 7 are a chain (5's output
+ * is 6's input and 6's output is 7's input) where 5 and 7 have the same copy
+ * count but 6 doesn't, so they have to be run in order and not grouped.
+ * Returns the number of failures.
+ */
+int check_batch(const LADSPA_Data * input, unsigned long sample_count,
+                unsigned long copies)
 {
-    // exit if run without 3 arguments
-    if (argc != 4)
+    const LADSPA_Descriptor * descriptor = ladspa_descriptor(0);
+    const unsigned long other_copies = copies < 100 ? copies * 2 : copies / 2;
+    LADSPA_Data copy_counts[BATCH_SIZE];
+    LADSPA_Handle instances[BATCH_SIZE];
+    LADSPA_Data * outputs[2][BATCH_SIZE];
+    unsigned long way;
+    unsigned long instance;
+    unsigned long index;
+    int failures = 0;
+
+    for (instance = 0; instance < BATCH_SIZE; ++instance)
+        copy_counts[instance] = (LADSPA_Data) copies;
+    copy_counts[3] = (LADSPA_Data) other_copies;
+    copy_counts[6] = (LADSPA_Data) other_copies;
+
+    for (way = 0; way < 2; ++way)
     {
-        printf("\nNeed 3 arguments: number of total samples, number of sample");
-        printf(" copies, and filename for test results (in that order).\n");
-        exit(-1);
+        for (instance = 0; instance < BATCH_SIZE; ++instance)
+        {
+            outputs[way][instance] =
+                    calloc(sample_count, sizeof (LADSPA_Data));
+            instances[instance] = descriptor->instantiate(descriptor, 44100);
+            if (!outputs[way][instance] || !instances[instance])
+                exit(-1);
+            descriptor->connect_port(instances[instance], RINGER_COPY_COUNT,
+                                     &copy_counts[instance]);
+            descriptor->activate(instances[instance]);
+        }
+
+        // put instance 4 out of step with the others
+        descriptor->connect_port(instances[4], RINGER_INPUT,
+                                 (LADSPA_Data *) input);
+        descriptor->connect_port(instances[4], RINGER_OUTPUT,
+                                 outputs[way][4]);
+        descriptor->run(instances[4], sample_count < 3 ? sample_count : 3);
+
+        for (index = 0; index < sample_count; index += 7)
+        {
+            unsigned long length = sample_count - index;
+            if (length > 7)
+                length = 7;
+
+            for (instance = 0; instance < BATCH_SIZE; ++instance)
+            {
+                const LADSPA_Data * source = input;
+                if (instance == 6 || instance == 7)
+                    source = outputs[way][instance - 1];
+
+                descriptor->connect_port(instances[instance], RINGER_INPUT,
+                                         (LADSPA_Data *) source + index);
+                descriptor->connect_port(instances[instance], RINGER_OUTPUT,
+                                         outputs[way][instance] + index);
+            }
+
+            if (way == 0)
+                for (instance = 0; instance < BATCH_SIZE; ++instance)
+                    descriptor->run(instances[instance], length);
+            else
+            {
+                ringer_run_batch(instances, BATCH_GROUPED, length);
+                ringer_run_batch(instances + BATCH_GROUPED,
+                                 BATCH_SIZE - BATCH_GROUPED, length);
+            }
+        }
+
+        for (instance = 0; instance < BATCH_SIZE; ++instance)
+            descriptor->cleanup(instances[instance]);
     }
 
-    // get the file name
-    filename = malloc(sizeof (char) * strlen(argv[3]));
-    if (!filename)
+    for (instance = 0; instance < BATCH_SIZE; ++instance)
+    {
+        if (memcmp(outputs[0][instance], outputs[1][instance],
+                   sizeof (LADSPA_Data) * sample_count) != 0)
+        {
+            printf("\nFAIL: ringer_run_batch() gave a different result for "
+                   "instance %lu\n", instance);
+            ++failures;
+        }
+        free(outputs[0][instance]);
+        free(outputs[1][instance]);
+    }
+
+    return failures;
+}
+
+
+/*
+ * Finds the plugin with the given label, or returns NULL.
+ */
+const LADSPA_Descriptor * find_plugin(const char * label)
+{
+    const LADSPA_Descriptor * descriptor;
+    unsigned long index;
+
+    for (index = 0; (descriptor = ladspa_descriptor(index)); ++index)
+        if (!strcmp(descriptor->Label, label))
+            return descriptor;
+    return NULL;
+}
+
+
+/*
+ * Runs a step from 0 to 1 (landing on the start of a hold) through the
+ * band-limited plugin, in blocks of 7 samples.  With the band-limiting
+ * turned off the output should be the same hard step as the mono plugin's;
+ * turned on, it should be 0 until the step (the smoothing adds nothing ahead
+ * of it), rise from there without overshooting much and then settle at
+ * exactly 1 once the step's smoothing is done, BLEP_SPAN (8) holds later (at
+ * most 128 samples).  Returns the number of failures.
+ */
+int check_band_limited(unsigned long copies)
+{
+    const LADSPA_Descriptor * descriptor = find_plugin("Ringer_BandLimited");
+    const unsigned long step_at = 10 * copies;
+    const unsigned long settled_at =
+            step_at + 8 * (copies < 16 ? copies : 16);
+    const unsigned long sample_count = settled_at + 4 * copies;
+    LADSPA_Data copy_count = (LADSPA_Data) copies;
+    LADSPA_Data mode;
+    LADSPA_Data * input = malloc(sizeof (LADSPA_Data) * sample_count);
+    LADSPA_Data * output = malloc(sizeof (LADSPA_Data) * sample_count);
+    LADSPA_Handle instance;
+    unsigned long i;
+    int failures = 0;
+
+    if (!descriptor || !input || !output)
+        exit(-1);
+    instance = descriptor->instantiate(descriptor, 44100);
+    if (!instance)
         exit(-1);
-    strcpy(filename, argv[3]);
 
-    const unsigned long BUFFER_SIZE = (unsigned long) atol(argv[1]);
+    for (i = 0; i < sample_count; ++i)
+        input[i] = i < step_at ? 0.0f : 1.0f;
+
+    descriptor->connect_port(instance, RINGER_COPY_COUNT, &copy_count);
+    descriptor->connect_port(instance, RINGER_MODE, &mode);
 
-    // create a pseudo Ringer instance
-    Ringer * ringer = malloc(sizeof (ringer));
-    if (!ringer)
+    for (mode = 0.0f; mode <= 1.0f; mode += 1.0f)
     {
-        free(filename);
-        exit(-1);
+        LADSPA_Data highest = 0.0f;
+
+        descriptor->activate(instance);
+        for (i = 0; i < sample_count; i += 7)
+        {
+            descriptor->connect_port(instance, RINGER_INPUT, input + i);
+            descriptor->connect_port(instance, RINGER_OUTPUT, output + i);
+            descriptor->run(instance, sample_count - i < 7
+                                      ? sample_count - i : 7);
+        }
+
+        for (i = 0; i < sample_count; ++i)
+            if (output[i] > highest)
+                highest = output[i];
+
+        if (mode == 0.0f)
+        {
+            if (memcmp(input, output, sizeof (LADSPA_Data) * sample_count))
+            {
+                printf("\nFAIL: the band-limited plugin changed a step with "
+                       "its band-limiting off\n");
+                ++failures;
+            }
+            continue;
+        }
+
+        for (i = 0; i < step_at; ++i)
+            if (output[i] != 0.0f)
+                break;
+        if (i < step_at)
+        {
+            printf("\nFAIL: band-limited output[%lu] is %f before the step\n",
+                   i, output[i]);
+            ++failures;
+        }
+        if (output[step_at] > 0.5f)
+        {
+            printf("\nFAIL: the band-limited step isn't smoothed (%f at its "
+                   "start)\n", output[step_at]);
+            ++failures;
+        }
+        if (highest > 1.25f)
+        {
+            printf("\nFAIL: the band-limited step overshoots to %f\n",
+                   highest);
+            ++failures;
+        }
+        for (i = settled_at; i < sample_count; ++i)
+            if (output[i] != 1.0f)
+            {
+                printf("\nFAIL: the band-limited step hasn't settled at "
+                       "output[%lu] (%f)\n", i, output[i]);
+                ++failures;
+                break;
+            }
     }
 
-    // create a psuedo input buffer of audio samples.
-    // the sample values are arbitrary, but they are sequential in order
-    // to read the output easier.
-    ringer->Input = malloc(sizeof (LADSPA_Data) * BUFFER_SIZE);
-    if (!ringer->Input)
+    descriptor->cleanup(instance);
+    free(input);
+    free(output);
+    return failures;
+}
+
+
+/*
+ * Runs ringer_run_int16() and ringer_run_int24() over 'sample_count' samples
+ * in blocks of 7, so the hold has to carry over from one call to the next,
+ * and checks every output sample is a copy of the first input sample of its
+ * hold.  'copy_count' is the one given on the command line, which they
+ * should clamp to 5..200 ('copies') like the plugin does.  The 24-bit samples
+ * are run in place, and their 3 bytes have to come out in the order they went
+ * in.  Returns the number of failures.
+ */
+int check_pcm(unsigned long sample_count, int copy_count, unsigned long copies)
+{
+    int16_t * input16 = malloc(sizeof (int16_t) * sample_count);
+    int16_t * output16 = malloc(sizeof (int16_t) * sample_count);
+    unsigned char * input24 = malloc(3 * sample_count);
+    unsigned char * samples24 = malloc(3 * sample_count);
+    Ringer_pcm_state state;
+    unsigned long i;
+    int failures = 0;
+
+    if (!input16 || !output16 || !input24 || !samples24)
+        exit(-1);
+
+    // arbitrary samples, with every byte different from its neighbours
+    for (i = 0; i < sample_count; ++i)
     {
-        free(filename);
-        free(ringer);
+        input16[i] = (int16_t) (i * 7919);
+        input24[3 * i] = (unsigned char) i;
+        input24[3 * i + 1] = (unsigned char) (i >> 8);
+        input24[3 * i + 2] = (unsigned char) (i * 31 + 128);
+    }
+    memcpy(samples24, input24, 3 * sample_count);
+
+    ringer_pcm_reset(&state);
+    for (i = 0; i < sample_count; i += 7)
+        ringer_run_int16(&state, input16 + i, output16 + i,
+                         sample_count - i < 7 ? sample_count - i : 7,
+                         copy_count);
+
+    for (i = 0; i < sample_count; ++i)
+        if (output16[i] != input16[i - i % copies])
+        {
+            printf("\nFAIL: int16 output[%lu] is %d, should be %d\n", i,
+                   output16[i], input16[i - i % copies]);
+            ++failures;
+            break;
+        }
+
+    ringer_pcm_reset(&state);
+    for (i = 0; i < sample_count; i += 7)
+        ringer_run_int24(&state, samples24 + 3 * i, samples24 + 3 * i,
+                         sample_count - i < 7 ? sample_count - i : 7,
+                         copy_count);
+
+    for (i = 0; i < sample_count; ++i)
+        if (memcmp(samples24 + 3 * i, input24 + 3 * (i - i % copies), 3))
+        {
+            printf("\nFAIL: int24 output[%lu] is %02x %02x %02x, should be "
+                   "%02x %02x %02x\n", i, samples24[3 * i],
+                   samples24[3 * i + 1], samples24[3 * i + 2],
+                   input24[3 * (i - i % copies)],
+                   input24[3 * (i - i % copies) + 1],
+                   input24[3 * (i - i % copies) + 2]);
+            ++failures;
+            break;
+        }
+
+    free(input16);
+    free(output16);
+    free(input24);
+    free(samples24);
+    return failures;
+}
+
+
+/*
+ * Encodes 'input' as runs and as decimated values, expands both back 7
+ * samples at a time and checks that gives 'expected' (the plugin's output)
+ * and then stops.  'copy_count' is the one given on the command line, which
+ * should be clamped to 5..200 ('copies') like the plugin does.  Returns the
+ * number of failures.
+ */
+int check_runs(const LADSPA_Data * input, const LADSPA_Data * expected,
+               unsigned long sample_count, int copy_count,
+               unsigned long copies)
+{
+    const unsigned long count = (sample_count + copies - 1) / copies;
+    Ringer_run * runs = malloc(sizeof (Ringer_run) * count);
+    LADSPA_Data * values = malloc(sizeof (LADSPA_Data) * count);
+    LADSPA_Data * expanded = malloc(sizeof (LADSPA_Data) * sample_count);
+    Ringer_expander expander;
+    unsigned long written;
+    unsigned long total;
+    int use_values;
+    int failures = 0;
+
+    if (!runs || !values || !expanded)
         exit(-1);
+
+    if (ringer_encode_runs(input, sample_count, copy_count, runs) != count
+        || ringer_decimate(input, sample_count, copy_count, values) != count)
+    {
+        printf("\nFAIL: the compact output doesn't have %lu runs/values\n",
+               count);
+        ++failures;
     }
-    int i = 0;
-    LADSPA_Data sample_val = 0.0f;
-    for (i = 0; i < BUFFER_SIZE; ++i)
+
+    for (use_values = 0; use_values < 2; ++use_values)
     {
-        ringer->Input[i] = sample_val;
-        sample_val += 1.0f;
+        if (use_values)
+            ringer_expander_init_values(&expander, values, count, copy_count,
+                                        sample_count);
+        else
+            ringer_expander_init_runs(&expander, runs, count);
+
+        memset(expanded, 0, sizeof (LADSPA_Data) * sample_count);
+        total = 0;
+        do
+        {
+            // never ask for more than is left, so an overrun would show
+            written = ringer_expand(&expander, expanded + total,
+                                    sample_count - total < 7
+                                    ? sample_count - total : 7);
+            total += written;
+        } while (written == 7);
+
+        if (total != sample_count
+            || ringer_expand(&expander, expanded, 1) != 0
+            || memcmp(expanded, expected,
+                      sizeof (LADSPA_Data) * sample_count) != 0)
+        {
+            printf("\nFAIL: expanding the %s gave a different result\n",
+                   use_values ? "values" : "runs");
+            ++failures;
+        }
     }
 
-    // create the output buffer and initialize it to all zeroes
-    ringer->Output = malloc(sizeof (LADSPA_Data) * BUFFER_SIZE);
-    if (!ringer->Output)
+    free(runs);
+    free(values);
+    free(expanded);
+    return failures;
+}
+
+
+/*
+ * Runs the mono plugin over 'input' in one ringer_run_events() call with two
+ * copy count changes in it, and again cutting the block up at the changes and
+ * calling run() on each piece with the copy count port set to match, and
+ * checks both give the same output.  Returns the number of failures.
+ */
+int check_events(const LADSPA_Data * input, unsigned long sample_count,
+                 unsigned long copies)
+{
+    const LADSPA_Descriptor * descriptor = ladspa_descriptor(0);
+    const Ringer_parameter_event events[2] =
     {
-        free(filename);
-        free(ringer->Input);
-        free(ringer);
+        { sample_count / 3, (LADSPA_Data) (copies < 100 ? copies * 2
+                                                        : copies / 2) },
+        { 2 * sample_count / 3, (LADSPA_Data) copies }
+    };
+    LADSPA_Data * outputs[2];
+    LADSPA_Data copy_count;
+    LADSPA_Handle instance;
+    unsigned long start;
+    unsigned long event;
+    int way;
+    int failures = 0;
+
+    for (way = 0; way < 2; ++way)
+    {
+        outputs[way] = calloc(sample_count, sizeof (LADSPA_Data));
+        instance = descriptor->instantiate(descriptor, 44100);
+        if (!outputs[way] || !instance)
+            exit(-1);
+
+        copy_count = (LADSPA_Data) copies;
+        descriptor->connect_port(instance, RINGER_COPY_COUNT, &copy_count);
+        descriptor->connect_port(instance, RINGER_INPUT,
+                                 (LADSPA_Data *) input);
+        descriptor->connect_port(instance, RINGER_OUTPUT, outputs[way]);
+        descriptor->activate(instance);
+
+        if (way == 0)
+            ringer_run_events(instance, sample_count, events, 2);
+        else
+        {
+            start = 0;
+            for (event = 0; event <= 2; ++event)
+            {
+                const unsigned long end =
+                        event < 2 ? events[event].frame : sample_count;
+
+                descriptor->connect_port(instance, RINGER_INPUT,
+                                         (LADSPA_Data *) input + start);
+                descriptor->connect_port(instance, RINGER_OUTPUT,
+                                         outputs[way] + start);
+                descriptor->run(instance, end - start);
+                if (event < 2)
+                    copy_count = events[event].copy_count;
+                start = end;
+            }
+        }
+
+        descriptor->cleanup(instance);
+    }
+
+    if (memcmp(outputs[0], outputs[1], sizeof (LADSPA_Data) * sample_count))
+    {
+        printf("\nFAIL: ringer_run_events() gave a different result from "
+               "run()\n");
+        ++failures;
+    }
+
+    free(outputs[0]);
+    free(outputs[1]);
+    return failures;
+}
+
+
+/*
+ * Runs 'input' (which counts up from 0, so each sample is its own index)
+ * through the fractional plugin with a copy count a quarter of a sample off
+ * 'copies', in blocks of 7.  Hold number k should start at sample
+ * floor(k * copy count), and every sample of it be a copy of that one.
+ * Returns the number of failures.
+ */
+int check_fractional(const LADSPA_Data * input, unsigned long sample_count,
+                     unsigned long copies)
+{
+    const LADSPA_Descriptor * descriptor = find_plugin("Ringer_Fractional");
+    LADSPA_Data copy_count = copies < 200 ? copies + 0.25f : copies - 0.75f;
+    LADSPA_Data * output = malloc(sizeof (LADSPA_Data) * sample_count);
+    LADSPA_Handle instance;
+    unsigned long hold = 0;
+    unsigned long hold_start = 0;
+    unsigned long i;
+    int failures = 0;
+
+    if (!descriptor || !output)
+        exit(-1);
+    instance = descriptor->instantiate(descriptor, 44100);
+    if (!instance)
         exit(-1);
+
+    descriptor->connect_port(instance, RINGER_COPY_COUNT, &copy_count);
+    descriptor->activate(instance);
+    for (i = 0; i < sample_count; i += 7)
+    {
+        descriptor->connect_port(instance, RINGER_INPUT,
+                                 (LADSPA_Data *) input + i);
+        descriptor->connect_port(instance, RINGER_OUTPUT, output + i);
+        descriptor->run(instance, sample_count - i < 7 ? sample_count - i : 7);
     }
-    for (i = 0; i < BUFFER_SIZE; ++i)
-        ringer->Output[i] = 0.0f;
+    descriptor->cleanup(instance);
 
-    // set the copy count
-    ringer->copy_count = malloc(sizeof (LADSPA_Data));
-    if (!ringer->copy_count)
+    for (i = 0; i < sample_count; ++i)
     {
-        free(filename);
-        free(ringer->Input);
-        free(ringer->Output);
-        free(ringer);
+        // (the quarters add up exactly in floats)
+        if (i == (unsigned long) ((hold + 1) * copy_count))
+            hold_start = (unsigned long) (++hold * copy_count);
+
+        if (output[i] != input[hold_start])
+        {
+            printf("\nFAIL: fractional output[%lu] is %f, should be %f (%.2f "
+                   "copies)\n", i, output[i], input[hold_start], copy_count);
+            ++failures;
+            break;
+        }
+    }
+
+    free(output);
+    return failures;
+}
+
+
+/*
+ * Runs run_adding() with a gain of 0.5 over 'input', in blocks of each of a
+ * few sizes, onto an output that already has something in it, and checks
+ * every output sample is what was there plus 0.5 times the held sample.
+ * (With a gain of 0.5 the product is exact, so it doesn't matter whether the
+ * kernels use fused multiply-adds or not.)  Returns the number of failures.
+ */
+int check_run_adding(const LADSPA_Data * input, unsigned long sample_count,
+                     unsigned long copies)
+{
+    static const unsigned long block_sizes[] = { 1, 7, 64, 1000000 };
+    const LADSPA_Descriptor * descriptor = ladspa_descriptor(0);
+    LADSPA_Data * output = malloc(sizeof (LADSPA_Data) * sample_count);
+    LADSPA_Data copy_count = (LADSPA_Data) copies;
+    LADSPA_Handle instance;
+    unsigned long size;
+    unsigned long i;
+    int failures = 0;
+
+    if (!output || !descriptor->run_adding || !descriptor->set_run_adding_gain)
+    {
+        printf("\nFAIL: the mono plugin has no run_adding()\n");
+        free(output);
+        return 1;
+    }
+    instance = descriptor->instantiate(descriptor, 44100);
+    if (!instance)
         exit(-1);
+    descriptor->connect_port(instance, RINGER_COPY_COUNT, &copy_count);
+    descriptor->set_run_adding_gain(instance, 0.5f);
+
+    for (size = 0; size < sizeof (block_sizes) / sizeof (block_sizes[0]);
+         ++size)
+    {
+        const unsigned long block_size = block_sizes[size];
+
+        for (i = 0; i < sample_count; ++i)
+            output[i] = 0.25f * (LADSPA_Data) (i % 1000) - 100.0f;
+
+        descriptor->activate(instance);
+        for (i = 0; i < sample_count; i += block_size)
+        {
+            descriptor->connect_port(instance, RINGER_INPUT,
+                                     (LADSPA_Data *) input + i);
+            descriptor->connect_port(instance, RINGER_OUTPUT, output + i);
+            descriptor->run_adding(instance, sample_count - i < block_size
+                                             ? sample_count - i : block_size);
+        }
+
+        for (i = 0; i < sample_count; ++i)
+        {
+            const LADSPA_Data expected = 0.25f * (LADSPA_Data) (i % 1000)
+                    - 100.0f + 0.5f * input[i - i % copies];
+
+            if (output[i] != expected)
+            {
+                printf("\nFAIL: run_adding() output[%lu] is %f, should be %f "
+                       "(blocks of %lu)\n", i, output[i], expected,
+                       block_size);
+                ++failures;
+                break;
+            }
+        }
     }
-    *(ringer->copy_count) = (LADSPA_Data) atof(argv[2]);
 
-    run_Ringer(ringer, BUFFER_SIZE);
+    descriptor->cleanup(instance);
+    free(output);
+    return failures;
+}
+
 
-    free(ringer->Input);
-    free(ringer->Output);
-    free(ringer->copy_count);
-    free(ringer);
-    free(filename);
+/*
+ * Runs each of the multichannel plugins over 'sample_count' samples in blocks
+ * of 7, with a different signal on every channel, and checks every channel
+ * comes out the same as the mono plugin gives for that signal in one block.
+ * That only works if all the channels share one hold and keep its phase from
+ * one block to the next.  Returns the number of failures.
+ */
+int check_multichannel(const LADSPA_Data * input, unsigned long sample_count,
+                       unsigned long copies)
+{
+    static const char * labels[] =
+    {
+        "Ringer_Stereo", "Ringer_Quad", "Ringer_5_1", "Ringer_8ch"
+    };
+    LADSPA_Data * inputs[8];
+    LADSPA_Data * outputs[8];
+    LADSPA_Data * expected[8];
+    LADSPA_Data copy_count = (LADSPA_Data) copies;
+    unsigned long plugin;
+    unsigned long channel;
+    unsigned long i;
+    int failures = 0;
 
-    return 0;
+    for (channel = 0; channel < 8; ++channel)
+    {
+        inputs[channel] = malloc(sizeof (LADSPA_Data) * sample_count);
+        outputs[channel] = malloc(sizeof (LADSPA_Data) * sample_count);
+        expected[channel] = malloc(sizeof (LADSPA_Data) * sample_count);
+        if (!inputs[channel] || !outputs[channel] || !expected[channel])
+            exit(-1);
+
+        for (i = 0; i < sample_count; ++i)
+            inputs[channel][i] = input[i] * (channel + 1) - channel;
+        if (!run_plugin(inputs[channel], expected[channel], sample_count,
+                        sample_count, copy_count))
+            exit(-1);
+    }
+
+    for (plugin = 0; plugin < sizeof (labels) / sizeof (labels[0]); ++plugin)
+    {
+        const LADSPA_Descriptor * descriptor = find_plugin(labels[plugin]);
+        unsigned long channel_count;
+        LADSPA_Handle instance;
+
+        if (!descriptor)
+        {
+            printf("\nFAIL: there is no %s plugin\n", labels[plugin]);
+            ++failures;
+            continue;
+        }
+        channel_count = (descriptor->PortCount - 1) / 2;
+        instance = descriptor->instantiate(descriptor, 44100);
+        if (!instance)
+            exit(-1);
+
+        descriptor->connect_port(instance, RINGER_COPY_COUNT, &copy_count);
+        descriptor->activate(instance);
+        for (i = 0; i < sample_count; i += 7)
+        {
+            for (channel = 0; channel < channel_count; ++channel)
+            {
+                descriptor->connect_port(instance, 1 + channel,
+                                         inputs[channel] + i);
+                descriptor->connect_port(instance,
+                                         1 + channel_count + channel,
+                                         outputs[channel] + i);
+            }
+            descriptor->run(instance,
+                            sample_count - i < 7 ? sample_count - i : 7);
+        }
+        descriptor->cleanup(instance);
+
+        for (channel = 0; channel < channel_count; ++channel)
+            if (memcmp(outputs[channel], expected[channel],
+                       sizeof (LADSPA_Data) * sample_count) != 0)
+            {
+                printf("\nFAIL: channel %lu of %s is different from the "
+                       "mono plugin\n", channel, labels[plugin]);
+                ++failures;
+            }
+    }
+
+    for (channel = 0; channel < 8; ++channel)
+    {
+        free(inputs[channel]);
+        free(outputs[channel]);
+        free(expected[channel]);
+    }
+    return failures;
 }
 
 
-void run_Ringer(LADSPA_Handle instance, unsigned long sample_count)
+/*
+ * Runs 'input' (which counts up from 0) through the audio-rate plugin in
+ * blocks of 7, with the copy count buffer changing from 'copies' to another
+ * count halfway through the second hold.  A hold's length is the copy count
+ * at the sample it starts on, so the second hold should still be 'copies'
+ * long and the new count should only take effect from the third hold on.
+ * Returns the number of failures.
+ */
+int check_audio_rate(const LADSPA_Data * input, unsigned long sample_count,
+                     unsigned long copies)
 {
-    Ringer * ringer = (Ringer *) instance;
+    const LADSPA_Descriptor * descriptor = find_plugin("Ringer_Modulated");
+    const unsigned long other_copies = copies < 100 ? copies * 2 : copies / 2;
+    LADSPA_Data * copy_counts = malloc(sizeof (LADSPA_Data) * sample_count);
+    LADSPA_Data * output = malloc(sizeof (LADSPA_Data) * sample_count);
+    LADSPA_Handle instance;
+    unsigned long hold_start;
+    unsigned long hold_length;
+    unsigned long holds;
+    unsigned long i;
+    int failures = 0;
+
+    if (!descriptor || !copy_counts || !output)
+        exit(-1);
+    instance = descriptor->instantiate(descriptor, 44100);
+    if (!instance)
+        exit(-1);
+
+    for (i = 0; i < sample_count; ++i)
+        copy_counts[i] = (LADSPA_Data) (i < copies + copies / 2
+                                        ? copies : other_copies);
 
-    /*
-     * NOTE: these special cases should never happen, but you never know--like
-     * if someone is developing a host program and it has some bugs in it, it
-     * might pass some bad data.
-     */
-    if (sample_count <= 1)
+    descriptor->activate(instance);
+    for (i = 0; i < sample_count; i += 7)
     {
-        printf("\nEither 0 or 1 sample(s) were passed into the plugin.");
-        printf("\nPlugin not executed.\n");
-        return;
+        descriptor->connect_port(instance, RINGER_COPY_COUNT,
+                                 copy_counts + i);
+        descriptor->connect_port(instance, RINGER_INPUT,
+                                 (LADSPA_Data *) input + i);
+        descriptor->connect_port(instance, RINGER_OUTPUT, output + i);
+        descriptor->run(instance, sample_count - i < 7 ? sample_count - i : 7);
     }
-    if (!ringer)
+    descriptor->cleanup(instance);
+
+    // holds 0 and 1 are 'copies' long and the rest 'other_copies'
+    hold_start = 0;
+    for (holds = 0; hold_start < sample_count && !failures; ++holds)
     {
-        printf("\nPlugin received NULL pointer for plugin instance.");
-        printf("\nPlugin not executed.\n");
-        return;
+        hold_length = holds < 2 ? copies : other_copies;
+        for (i = hold_start; i < hold_start + hold_length && i < sample_count;
+             ++i)
+            if (output[i] != input[hold_start])
+            {
+                printf("\nFAIL: audio-rate output[%lu] is %f, should be %f "
+                       "(hold %lu)\n", i, output[i], input[hold_start],
+                       holds);
+                ++failures;
+                break;
+            }
+        hold_start += hold_length;
     }
 
-    LADSPA_Data * input; // to point to the input stream
-    LADSPA_Data * output; // to point to the output stream
+    free(copy_counts);
+    free(output);
+    return failures;
+}
 
-    // link the local pointers to their appropriate streams passed in through
-    // instance
-    input = ringer->Input;
-    output = ringer->Output;
 
-    // indexes for the input and output buffers
-    unsigned long in_index = 0;
-    unsigned long out_index = 0;
+// port numbers of the DSP load plugin's outputs
+#define RINGER_LOAD 3
+#define RINGER_PEAK_LOAD 4
+// samples check_load() times in one block
+#define LOAD_SAMPLES (1 << 20)
 
-    // set the number of copies to be made
-    const int SAMPLE_COPY_COUNT =
-                           LIMIT_BETWEEN_5_AND_500((int) *(ringer->copy_count));
 
-//----------------FILE INITIATION FOR TEST RESULTS-----------------------------
-    FILE * write_file = NULL;
-    write_file = fopen(filename, "w");
-    if (!write_file)
+/*
+ * Checks the DSP load plugin's two output ports: that they are control
+ * outputs, that activate() sets them to 0, and that after a run they are
+ * finite, not negative and the peak is at least the load.  It also times one
+ * big block itself and compares that with the load the plugin reports, which
+ * is only right if the plugin's clock was calibrated (the first time one of
+ * these plugins was instantiated).  Returns the number of failures.
+ */
+int check_load()
+{
+    const LADSPA_Descriptor * descriptor = find_plugin("Ringer_Load");
+    const unsigned long sample_rate = 44100;
+    LADSPA_Data * samples = calloc(LOAD_SAMPLES, sizeof (LADSPA_Data));
+    LADSPA_Data copy_count = 16.0f;
+    LADSPA_Data load = -1.0f;
+    LADSPA_Data peak_load = -1.0f;
+    LADSPA_Handle instance;
+    struct timespec start, end;
+    double measured;
+    int failures = 0;
+
+    if (!descriptor || !samples)
+        exit(-1);
+    if (descriptor->PortCount != 5
+        || descriptor->PortDescriptors[RINGER_LOAD]
+           != (LADSPA_PORT_OUTPUT | LADSPA_PORT_CONTROL)
+        || descriptor->PortDescriptors[RINGER_PEAK_LOAD]
+           != (LADSPA_PORT_OUTPUT | LADSPA_PORT_CONTROL))
     {
-        printf("\n**Error: fail to create file 'test_results.txt'\n");
-        return;
+        printf("\nFAIL: Ringer_Load doesn't have its two load outputs\n");
+        free(samples);
+        return 1;
     }
 
-    fprintf(write_file, "\nSample Count: %ld\n", sample_count);
-//-----------------------------------------------------------------------------
+    instance = descriptor->instantiate(descriptor, sample_rate);
+    if (!instance)
+        exit(-1);
+    descriptor->connect_port(instance, RINGER_COPY_COUNT, &copy_count);
+    descriptor->connect_port(instance, RINGER_INPUT, samples);
+    descriptor->connect_port(instance, RINGER_OUTPUT, samples);
+    descriptor->connect_port(instance, RINGER_LOAD, &load);
+    descriptor->connect_port(instance, RINGER_PEAK_LOAD, &peak_load);
+    descriptor->activate(instance);
 
-    while (in_index < sample_count)
+    if (load != 0.0f || peak_load != 0.0f)
     {
-        output[out_index++] = input[in_index];
+        printf("\nFAIL: the load outputs are %f and %f after activate(), "
+               "not 0\n", load, peak_load);
+        ++failures;
+    }
 
-//-----------------------------------------------------------------------------
-        fprintf(write_file, "\n%f", input[in_index]);
-//-----------------------------------------------------------------------------
+    descriptor->run(instance, 7);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    descriptor->run(instance, LOAD_SAMPLES);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    descriptor->cleanup(instance);
+
+    // the load is the percentage of the time the block lasts
+    measured = ((end.tv_sec - start.tv_sec)
+                + (end.tv_nsec - start.tv_nsec) / 1e9)
+               * 100.0 * sample_rate / LOAD_SAMPLES;
+
+    // (x != x only for NaN)
+    if (load != load || peak_load != peak_load || load < 0.0f
+        || peak_load < load || load > 1e30f || peak_load > 1e30f)
+    {
+        printf("\nFAIL: the load outputs are %f and %f after running\n",
+               load, peak_load);
+        ++failures;
+    }
+    else if (load < 0.75 * measured || load > 1.33 * measured)
+    {
+        printf("\nFAIL: the plugin says its load is %f%%, but it took "
+               "%f%%\n", load, measured);
+        ++failures;
+    }
+
+    free(samples);
+    return failures;
+}
+
+
+// number of samples check_streaming() runs: more than the 1024 samples
+// stream_block() stages at a time, and not a whole number of tiles
+#define STREAM_SAMPLES (3 * 1024 + 37)
 
-        if (in_index >= sample_count - (SAMPLE_COPY_COUNT - 1)
-            || (sample_count - (SAMPLE_COPY_COUNT - 1))
-                >= 0xFFFFFFFFFFFFFFFF - (SAMPLE_COPY_COUNT - 1))
+/*
+ * Runs a few of the plugins (the mono, some multichannel and the audio-rate
+ * ones) with ringer_set_streaming_threshold(1), so every block goes through
+ * the streaming code: once on output buffers that aren't aligned, in blocks
+ * of 1 and then of more than a tile, and once in place.  The output should
+ * be exactly the same as the normal way's.  Returns the number of failures.
+ */
+int check_streaming(unsigned long copies)
+{
+    static const char * labels[] =
+    {
+        "Ringer", "Ringer_Stereo", "Ringer_5_1", "Ringer_8ch",
+        "Ringer_Modulated"
+    };
+    static const unsigned long blocks[] = { 1, 2 * 1024 + 3, STREAM_SAMPLES };
+    LADSPA_Data * inputs[8];
+    LADSPA_Data * outputs[8];
+    LADSPA_Data * expected[8];
+    LADSPA_Data * copy_counts = malloc(sizeof (LADSPA_Data) * STREAM_SAMPLES);
+    LADSPA_Data copy_count = (LADSPA_Data) copies;
+    unsigned long plugin;
+    unsigned long channel;
+    unsigned long i;
+    int failures = 0;
+
+    if (!copy_counts)
+        exit(-1);
+    // the audio-rate plugin gets holds of a few different lengths
+    for (i = 0; i < STREAM_SAMPLES; ++i)
+        copy_counts[i] = (LADSPA_Data) (copies + (i / 500) % 3);
+
+    // one sample more than needed, so the buffers can be misaligned
+    for (channel = 0; channel < 8; ++channel)
+    {
+        inputs[channel] = malloc(sizeof (LADSPA_Data) * (STREAM_SAMPLES + 1));
+        outputs[channel] = malloc(sizeof (LADSPA_Data) * (STREAM_SAMPLES + 1));
+        expected[channel] = malloc(sizeof (LADSPA_Data) * STREAM_SAMPLES);
+        if (!inputs[channel] || !outputs[channel] || !expected[channel])
+            exit(-1);
+    }
+
+    for (plugin = 0; plugin < sizeof (labels) / sizeof (labels[0]); ++plugin)
+    {
+        const LADSPA_Descriptor * descriptor = find_plugin(labels[plugin]);
+        unsigned long channel_count;
+        unsigned long pass;
+        LADSPA_Handle instance;
+
+        if (!descriptor)
         {
-            while (out_index < sample_count)
+            printf("\nFAIL: there is no %s plugin\n", labels[plugin]);
+            ++failures;
+            continue;
+        }
+        channel_count = (descriptor->PortCount - 1) / 2;
+        instance = descriptor->instantiate(descriptor, 44100);
+        if (!instance)
+            exit(-1);
+        descriptor->connect_port(instance, RINGER_COPY_COUNT,
+                                 LADSPA_IS_PORT_AUDIO(
+                                         descriptor->PortDescriptors[0])
+                                 ? copy_counts : &copy_count);
 
-//-----------------------------------------------------------------------------
+        // pass 0: the normal way, in one block, into 'expected'
+        // pass 1: streamed, misaligned, in blocks of 1, 2051 and the rest
+        // pass 2: streamed, in place (in 'inputs', which get overwritten)
+        for (pass = 0; pass < 3; ++pass)
+        {
+            LADSPA_Data * ins[8];
+            LADSPA_Data * outs[8];
+            unsigned long block;
+            unsigned long start;
+
+            for (channel = 0; channel < channel_count; ++channel)
             {
-                fprintf(write_file, "\n%f", input[in_index]);
-//-----------------------------------------------------------------------------
+                ins[channel] = inputs[channel] + (pass == 1);
+                outs[channel] = pass == 0 ? expected[channel]
+                                : pass == 1 ? outputs[channel] + 1
+                                : ins[channel];
+                for (i = 0; i < STREAM_SAMPLES; ++i)
+                    ins[channel][i] = (LADSPA_Data) (i * (channel + 1));
+            }
 
-                output[out_index++] = input[in_index];
+            ringer_set_streaming_threshold(pass == 0 ? 0 : 1);
+            descriptor->activate(instance);
+            for (block = 0, start = 0; start < STREAM_SAMPLES; ++block)
+            {
+                unsigned long length = pass == 0 ? STREAM_SAMPLES
+                                       : blocks[block];
+                if (length > STREAM_SAMPLES - start)
+                    length = STREAM_SAMPLES - start;
 
-//-----------------------------------------------------------------------------
+                for (channel = 0; channel < channel_count; ++channel)
+                {
+                    descriptor->connect_port(instance, 1 + channel,
+                                             ins[channel] + start);
+                    descriptor->connect_port(instance,
+                                             1 + channel_count + channel,
+                                             outs[channel] + start);
+                }
+                if (LADSPA_IS_PORT_AUDIO(descriptor->PortDescriptors[0]))
+                    descriptor->connect_port(instance, RINGER_COPY_COUNT,
+                                             copy_counts + start);
+                descriptor->run(instance, length);
+                start += length;
             }
-//-----------------------------------------------------------------------------
+            descriptor->deactivate(instance);
 
-            break;
+            for (channel = 0; pass && channel < channel_count; ++channel)
+                if (memcmp(outs[channel], expected[channel],
+                           sizeof (LADSPA_Data) * STREAM_SAMPLES) != 0)
+                {
+                    printf("\nFAIL: channel %lu of %s is different when "
+                           "streamed%s\n", channel, labels[plugin],
+                           pass == 1 ? " to a misaligned buffer"
+                           : " in place");
+                    ++failures;
+                }
         }
+        descriptor->cleanup(instance);
+    }
+    ringer_set_streaming_threshold(0);
 
-        while (out_index < in_index + SAMPLE_COPY_COUNT)
+    for (channel = 0; channel < 8; ++channel)
+    {
+        free(inputs[channel]);
+        free(outputs[channel]);
+        free(expected[channel]);
+    }
+    free(copy_counts);
+    return failures;
+}
 
-//-----------------------------------------------------------------------------
+
+// the bitcrushed plugin's bit depth and gain ports
+#define RINGER_BITS 3
+#define RINGER_GAIN 4
+// number of samples check_crush() runs (a ramp from -1.5 to 1.5)
+#define CRUSH_SAMPLES 601
+
+/*
+ * Runs a ramp from -1.5 to 1.5 through the bitcrushed plugin at 1, 8 and 24
+ * bits with the default gain (0 dB).  Each output sample should be the first
+ * input sample of its hold, clipped to -1 to 1 and rounded (halves away from
+ * zero) to a multiple of 1 / 2^(bits - 1).  Returns the number of failures.
+ */
+int check_crush(unsigned long copies)
+{
+    static const int depths[] = { 1, 8, 24 };
+    const LADSPA_Descriptor * descriptor = find_plugin("Ringer_Crush");
+    LADSPA_Data input[CRUSH_SAMPLES];
+    LADSPA_Data output[CRUSH_SAMPLES];
+    LADSPA_Data copy_count = (LADSPA_Data) copies;
+    LADSPA_Data gain = 0.0f;
+    LADSPA_Data bits;
+    LADSPA_Handle instance;
+    unsigned long depth;
+    unsigned long i;
+    int failures = 0;
+
+    if (!descriptor)
+    {
+        printf("\nFAIL: there is no Ringer_Crush plugin\n");
+        return 1;
+    }
+    instance = descriptor->instantiate(descriptor, 44100);
+    if (!instance)
+        exit(-1);
+
+    for (i = 0; i < CRUSH_SAMPLES; ++i)
+        input[i] = -1.5f + 0.005f * i;
+
+    descriptor->connect_port(instance, RINGER_COPY_COUNT, &copy_count);
+    descriptor->connect_port(instance, RINGER_BITS, &bits);
+    descriptor->connect_port(instance, RINGER_GAIN, &gain);
+    descriptor->connect_port(instance, RINGER_INPUT, input);
+    descriptor->connect_port(instance, RINGER_OUTPUT, output);
+
+    for (depth = 0; depth < sizeof (depths) / sizeof (depths[0]); ++depth)
+    {
+        const double steps = (double) (1L << (depths[depth] - 1));
+
+        bits = (LADSPA_Data) depths[depth];
+        descriptor->activate(instance);
+        descriptor->run(instance, CRUSH_SAMPLES);
+        descriptor->deactivate(instance);
+
+        for (i = 0; i < CRUSH_SAMPLES; ++i)
         {
-            fprintf(write_file, "\n%f", input[in_index]);
-//-----------------------------------------------------------------------------
+            double sample = input[i - i % copies];
+            double scaled;
+            LADSPA_Data expected;
 
-            output[out_index++] = input[in_index];
+            if (sample > 1.0)
+                sample = 1.0;
+            else if (sample < -1.0)
+                sample = -1.0;
+            scaled = sample * steps;
+            expected = (LADSPA_Data)
+                    ((long) (scaled + (scaled < 0.0 ? -0.5 : 0.5)) / steps);
 
-//-----------------------------------------------------------------------------
+            if (output[i] != expected)
+            {
+                printf("\nFAIL: at %d bits, output[%lu] is %.9f, should be "
+                       "%.9f\n", depths[depth], i, output[i], expected);
+                ++failures;
+                break;
+            }
         }
-//-----------------------------------------------------------------------------
 
-        in_index += SAMPLE_COPY_COUNT;
+        // and the ends of the ramp are past full scale, so they clip
+        if (output[0] != -1.0f || output[CRUSH_SAMPLES - 1] != 1.0f)
+        {
+            printf("\nFAIL: at %d bits, -1.5 and 1.5 came out as %f and %f, "
+                   "should be -1 and 1\n", depths[depth], output[0],
+                   output[CRUSH_SAMPLES - 1]);
+            ++failures;
+        }
+    }
+
+    descriptor->cleanup(instance);
+    return failures;
+}
+
+
+// number of instances check_pool() creates: more than fit in the instance
+// pool's first two slabs (64 each)
+#define POOL_INSTANCES 150
+// size of a cache line (every instance should start on one)
+#define CACHE_LINE_SIZE 64
+
+/*
+ * Creates enough mono Ringers to make the instance pool grow, frees every
+ * third one and creates them again.  Every instance should start on its own
+ * cache line, the new ones should reuse the freed slots, and they should all
+ * still work, each with its own copy count, when run together afterwards.
+ * Returns the number of failures.
+ */
+int check_pool()
+{
+    const LADSPA_Descriptor * descriptor = find_plugin("Ringer");
+    LADSPA_Handle instances[POOL_INSTANCES];
+    LADSPA_Handle freed[(POOL_INSTANCES + 2) / 3];
+    LADSPA_Data copy_counts[POOL_INSTANCES];
+    LADSPA_Data input[32];
+    LADSPA_Data output[32];
+    unsigned long i;
+    unsigned long j;
+    unsigned long k;
+    int failures = 0;
+
+    if (!descriptor)
+        exit(-1);
+    for (i = 0; i < 32; ++i)
+        input[i] = (LADSPA_Data) i;
+
+    for (i = 0; i < POOL_INSTANCES; ++i)
+    {
+        instances[i] = descriptor->instantiate(descriptor, 44100);
+        if (!instances[i])
+        {
+            printf("\nFAIL: instance %lu couldn't be created\n", i);
+            return failures + 1;
+        }
+    }
+
+    // free every third one, then make them again: the new ones should get
+    // the freed slots back instead of growing the pool further
+    for (i = 0; i < POOL_INSTANCES; i += 3)
+    {
+        freed[i / 3] = instances[i];
+        descriptor->cleanup(instances[i]);
+    }
+    for (i = 0; i < POOL_INSTANCES; i += 3)
+    {
+        instances[i] = descriptor->instantiate(descriptor, 44100);
+        if (!instances[i])
+        {
+            printf("\nFAIL: instance %lu couldn't be created again\n", i);
+            ++failures;
+            continue;
+        }
+        for (j = 0; j < (POOL_INSTANCES + 2) / 3; ++j)
+            if (instances[i] == freed[j])
+                break;
+        if (j == (POOL_INSTANCES + 2) / 3)
+        {
+            printf("\nFAIL: instance %lu didn't reuse a freed slot\n", i);
+            ++failures;
+        }
+    }
+
+    for (i = 0; i < POOL_INSTANCES; ++i)
+    {
+        if (!instances[i])
+            continue;
+        if ((uintptr_t) instances[i] % CACHE_LINE_SIZE != 0)
+        {
+            printf("\nFAIL: instance %lu (%p) isn't on a cache line\n", i,
+                   instances[i]);
+            ++failures;
+        }
+        for (j = 0; j < i; ++j)
+            if (instances[i] == instances[j])
+            {
+                printf("\nFAIL: instances %lu and %lu are the same\n", j, i);
+                ++failures;
+            }
+
+        copy_counts[i] = (LADSPA_Data) (5 + i % 10);
+        descriptor->connect_port(instances[i], RINGER_COPY_COUNT,
+                                 &copy_counts[i]);
+        descriptor->activate(instances[i]);
+    }
+
+    // run them all only once they're all set up, so one instance writing
+    // over another would show up
+    for (i = 0; i < POOL_INSTANCES; ++i)
+    {
+        if (!instances[i])
+            continue;
+        descriptor->connect_port(instances[i], RINGER_INPUT, input);
+        descriptor->connect_port(instances[i], RINGER_OUTPUT, output);
+        descriptor->run(instances[i], 32);
+        for (k = 0; k < 32; ++k)
+            if (output[k] != input[k - k % (5 + i % 10)])
+            {
+                printf("\nFAIL: instance %lu's output[%lu] is %f, should be "
+                       "%f\n", i, k, output[k], input[k - k % (5 + i % 10)]);
+                ++failures;
+                break;
+            }
+        descriptor->cleanup(instances[i]);
+    }
+
+    return failures;
+}
+
+
+// number of diagnostic events the plugin keeps (EVENT_RING_SIZE in
+// sb_ringer.c)
+#define EVENT_RING_SIZE 256
+// number of events check_diagnostics() writes past a full event buffer
+#define OVERFLOW_EVENTS 10
+
+/*
+ * Calls run() with a sample count of 0 and with a NULL instance, which should
+ * each record a diagnostic event, and reads them back with
+ * ringer_read_events() (the first one on its own, to check that reading part
+ * of the events leaves the rest).  Then records OVERFLOW_EVENTS more events
+ * than the event buffer holds: only the newest EVENT_RING_SIZE should be
+ * read back, and the rest should be counted by ringer_lost_events().
+ * Returns the number of failures.
+ */
+int check_diagnostics()
+{
+    const LADSPA_Descriptor * descriptor = ladspa_descriptor(0);
+    Ringer_event events[EVENT_RING_SIZE + OVERFLOW_EVENTS];
+    unsigned long lost;
+    unsigned long count;
+    unsigned long i;
+    LADSPA_Handle instance;
+    int failures = 0;
 
-        if (in_index >= sample_count)
+    if (!descriptor)
+        exit(-1);
+    instance = descriptor->instantiate(descriptor, 44100);
+    if (!instance)
+        exit(-1);
+
+    // throw away whatever the other checks left behind
+    while (ringer_read_events(events, EVENT_RING_SIZE))
+        ;
+    lost = ringer_lost_events();
+
+    descriptor->run(instance, 0);
+    descriptor->run(NULL, 10);
+
+    count = ringer_read_events(events, 1);
+    count += ringer_read_events(events + 1, EVENT_RING_SIZE);
+    if (count != 2
+        || events[0].code != RINGER_EVENT_NO_SAMPLES
+        || events[0].instance != instance || events[0].sample_count != 0
+        || events[1].code != RINGER_EVENT_NULL_INSTANCE
+        || events[1].instance != NULL || events[1].sample_count != 10
+        || events[0].timestamp == 0
+        || events[1].timestamp < events[0].timestamp)
+    {
+        printf("\nFAIL: the bad run() calls weren't recorded properly (%lu "
+               "events read)\n", count);
+        ++failures;
+    }
+
+    // overflow the event buffer, with the sample counts numbering the events
+    for (i = 0; i < EVENT_RING_SIZE + OVERFLOW_EVENTS; ++i)
+        descriptor->run(NULL, i + 1);
+
+    count = ringer_read_events(events, EVENT_RING_SIZE + OVERFLOW_EVENTS);
+    if (count != EVENT_RING_SIZE)
+    {
+        printf("\nFAIL: read %lu events after an overflow, should be %d\n",
+               count, EVENT_RING_SIZE);
+        ++failures;
+    }
+    for (i = 0; i < count; ++i)
+        if (events[i].code != RINGER_EVENT_NULL_INSTANCE
+            || events[i].sample_count != OVERFLOW_EVENTS + i + 1)
+        {
+            printf("\nFAIL: event %lu after an overflow is code %d, sample "
+                   "count %lu\n", i, events[i].code, events[i].sample_count);
+            ++failures;
             break;
+        }
+    if (ringer_lost_events() - lost != OVERFLOW_EVENTS)
+    {
+        printf("\nFAIL: %lu events were counted as lost, should be %d\n",
+               ringer_lost_events() - lost, OVERFLOW_EVENTS);
+        ++failures;
+    }
+    if (ringer_read_events(events, 1) != 0)
+    {
+        printf("\nFAIL: there are still events left to read\n");
+        ++failures;
     }
 
-//-----------------------------------------------------------------------------
+    descriptor->cleanup(instance);
+    return failures;
+}
+
+
+// number of samples check_kernels() runs: two of the longest holds and an
+// odd bit over
+#define KERNEL_SAMPLES (2 * 200 + 13)
+// samples on either side of the output that nothing should write to
+#define KERNEL_GUARD 16
+
+/*
+ * Runs the mono plugin over 'input' into 'buffer' (which has KERNEL_GUARD
+ * samples before the output and KERNEL_GUARD + 15 after it) with the
+ * kernels for 'kernels', with the output starting 'offset' samples in.  How
+ * it is run depends on 'way': 0 is run() in one block, 1 is run() in blocks
+ * of 7 (so holds get split between blocks) and 2 is run_adding() in one
+ * block.  Returns 0 if the processor doesn't support the kernels.
+ */
+int run_kernels(int kernels, const LADSPA_Data * input,
+                LADSPA_Data * buffer, LADSPA_Data copy_count,
+                unsigned long offset, int way)
+{
+    const LADSPA_Descriptor * descriptor = ladspa_descriptor(0);
+    LADSPA_Data * output = buffer + KERNEL_GUARD + offset;
+    LADSPA_Handle instance;
+    unsigned long start;
+    unsigned long length;
+    unsigned long i;
+
+    if (!ringer_use_kernels(kernels))
+        return 0;
+    if (!descriptor)
+        exit(-1);
+    instance = descriptor->instantiate(descriptor, 44100);
+    if (!instance)
+        exit(-1);
+
+    for (i = 0; i < KERNEL_SAMPLES + 2 * KERNEL_GUARD + 15; ++i)
+        buffer[i] = 0.5f;
+
+    descriptor->connect_port(instance, RINGER_COPY_COUNT, &copy_count);
+    descriptor->activate(instance);
+    for (start = 0; start < KERNEL_SAMPLES; start += length)
+    {
+        length = KERNEL_SAMPLES - start;
+        if (way == 1 && length > 7)
+            length = 7;
+
+        descriptor->connect_port(instance, RINGER_INPUT,
+                                 (LADSPA_Data *) input + start);
+        descriptor->connect_port(instance, RINGER_OUTPUT, output + start);
+        if (way == 2)
+            descriptor->run_adding(instance, length);
+        else
+            descriptor->run(instance, length);
+    }
+    descriptor->cleanup(instance);
+    return 1;
+}
+
+
+/*
+ * Checks that the SSE2, AVX2 and AVX-512 kernels (whichever of them the
+ * processor supports), including the ones specialized for a hold length,
+ * give bit-identical output to the plain C ones, and so do the fastest ones
+ * without the specialized hold kernels.  Every copy count with a
+ * specialized kernel is tried, plus a few without, with the output at every
+ * alignment within a cache line and run each of the ways run_kernels() can.
+ * Nothing outside the output should be touched either.  Returns the number
+ * of failures.
+ */
+int check_kernels()
+{
+    static const int kernel_sets[] =
+    {
+        RINGER_KERNELS_SSE2, RINGER_KERNELS_AVX2, RINGER_KERNELS_AVX512,
+        RINGER_KERNELS_BEST | RINGER_KERNELS_GENERIC_HOLDS
+    };
+    static const char * kernel_names[] =
+    {
+        "SSE2", "AVX2", "AVX-512", "unspecialized hold"
+    };
+    static const int copy_counts[] =
+    {
+        5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 32, 37, 64, 128, 200
+    };
+    LADSPA_Data input[KERNEL_SAMPLES];
+    LADSPA_Data expected[KERNEL_SAMPLES + 2 * KERNEL_GUARD + 15];
+    LADSPA_Data output[KERNEL_SAMPLES + 2 * KERNEL_GUARD + 15];
+    unsigned long copies;
+    unsigned long offset;
+    unsigned long set;
+    unsigned long i;
+    int way;
+    int failures = 0;
+
+    for (i = 0; i < KERNEL_SAMPLES; ++i)
+        input[i] = 0.25f * i - 50.0f;
+
+    for (copies = 0; copies < sizeof (copy_counts) / sizeof (copy_counts[0]);
+         ++copies)
+        for (offset = 0; offset < 16; ++offset)
+            for (way = 0; way < 3; ++way)
+            {
+                run_kernels(RINGER_KERNELS_SCALAR, input, expected,
+                            (LADSPA_Data) copy_counts[copies], offset, way);
+
+                for (set = 0; set < sizeof (kernel_sets)
+                                    / sizeof (kernel_sets[0]); ++set)
+                {
+                    // skip the ones this processor doesn't have
+                    if (!run_kernels(kernel_sets[set], input, output,
+                                     (LADSPA_Data) copy_counts[copies],
+                                     offset, way))
+                        continue;
+
+                    if (memcmp(output, expected, sizeof (output)) != 0)
+                    {
+                        printf("\nFAIL: the %s kernels are different from "
+                               "the plain C ones (%d copies, offset %lu, "
+                               "way %d)\n", kernel_names[set],
+                               copy_counts[copies], offset, way);
+                        ++failures;
+                    }
+                }
+            }
+
+    ringer_use_kernels(RINGER_KERNELS_BEST);
+    return failures;
+}
+
+
+int main(int argc, char * argv[])
+{
+    // exit if run without 3 arguments
+    if (argc != 4)
+    {
+        printf("\nNeed 3 arguments: number of total samples, number of sample");
+        printf(" copies, and filename for test results (in that order).\n");
+        exit(-1);
+    }
+
+    const unsigned long BUFFER_SIZE = (unsigned long) atol(argv[1]);
+    const LADSPA_Data copy_count = (LADSPA_Data) atof(argv[2]);
+    const unsigned long SAMPLE_COPY_COUNT =
+            LIMIT_BETWEEN_5_AND_200((int) copy_count);
+
+    if (BUFFER_SIZE == 0)
+    {
+        printf("\nNeed at least 1 sample.\n");
+        exit(-1);
+    }
+
+    // create a psuedo input buffer of audio samples.
+    // the sample values are arbitrary, but they are sequential in order
+    // to read the output easier.
+    LADSPA_Data * input = malloc(sizeof (LADSPA_Data) * BUFFER_SIZE);
+    LADSPA_Data * output = malloc(sizeof (LADSPA_Data) * BUFFER_SIZE);
+    LADSPA_Data * in_place = malloc(sizeof (LADSPA_Data) * BUFFER_SIZE);
+    if (!input || !output || !in_place)
+        exit(-1);
+
+    unsigned long i = 0;
+    LADSPA_Data sample_val = 0.0f;
+    for (i = 0; i < BUFFER_SIZE; ++i)
+    {
+        input[i] = sample_val;
+        in_place[i] = sample_val;
+        output[i] = 0.0f;
+        sample_val += 1.0f;
+    }
+
+    int failures = 0;
+
+    // run it the normal way, in one block
+    if (!run_plugin(input, output, BUFFER_SIZE, BUFFER_SIZE, copy_count))
+    {
+        printf("\n**Error: could not create a Ringer instance\n");
+        exit(-1);
+    }
+
+//----------------FILE INITIATION FOR TEST RESULTS-----------------------------
+    FILE * write_file = NULL;
+    write_file = fopen(argv[3], "w");
+    if (!write_file)
+    {
+        printf("\n**Error: fail to create file '%s'\n", argv[3]);
+        exit(-1);
+    }
+
+    fprintf(write_file, "\nSample Count: %ld\n", BUFFER_SIZE);
+    for (i = 0; i < BUFFER_SIZE; ++i)
+        fprintf(write_file, "\n%f", output[i]);
     fclose(write_file);
 //-----------------------------------------------------------------------------
+
+    // every output sample should be a copy of the first input sample of its
+    // hold
+    for (i = 0; i < BUFFER_SIZE; ++i)
+        if (output[i] != input[i - i % SAMPLE_COPY_COUNT])
+        {
+            printf("\nFAIL: output[%lu] is %f, should be %f\n", i, output[i],
+                   input[i - i % SAMPLE_COPY_COUNT]);
+            ++failures;
+            break;
+        }
+
+    // now in place, in odd-sized blocks so that some holds start in one block
+    // and finish in the next
+    run_plugin(in_place, in_place, BUFFER_SIZE, 7, copy_count);
+    if (memcmp(in_place, output, sizeof (LADSPA_Data) * BUFFER_SIZE) != 0)
+    {
+        printf("\nFAIL: running in place gave a different result\n");
+        ++failures;
+    }
+
+    failures += check_batch(input, BUFFER_SIZE, SAMPLE_COPY_COUNT);
+    failures += check_runs(input, output, BUFFER_SIZE, (int) copy_count,
+                           SAMPLE_COPY_COUNT);
+    failures += check_events(input, BUFFER_SIZE, SAMPLE_COPY_COUNT);
+    failures += check_fractional(input, BUFFER_SIZE, SAMPLE_COPY_COUNT);
+    failures += check_band_limited(SAMPLE_COPY_COUNT);
+    failures += check_pcm(BUFFER_SIZE, (int) copy_count, SAMPLE_COPY_COUNT);
+    failures += check_run_adding(input, BUFFER_SIZE, SAMPLE_COPY_COUNT);
+    failures += check_multichannel(input, BUFFER_SIZE, SAMPLE_COPY_COUNT);
+    failures += check_audio_rate(input, BUFFER_SIZE, SAMPLE_COPY_COUNT);
+    failures += check_load();
+    failures += check_streaming(SAMPLE_COPY_COUNT);
+    failures += check_crush(SAMPLE_COPY_COUNT);
+    failures += check_pool();
+    failures += check_diagnostics();
+    failures += check_kernels();
+
+    free(input);
+    free(output);
+    free(in_place);
+
+    if (failures == 0)
+        printf("PASS: %lu samples, %lu copies\n", BUFFER_SIZE,
+               SAMPLE_COPY_COUNT);
+
+    return failures ? 1 : 0;
 }
@@ -0,0 +1,179 @@
+# Unit test for the ringer Python module (see ringer_python.c)
+#
+# Build the module with 'make python' and run this from the same directory
+# ('make test-python' does both).  It checks run()'s output against what
+# Ringer is supposed to produce (every channel holding each 'copies'-th
+# sample, from the start of the channel) for float32 and int16, 1-D and 2-D,
+# in place and into 'out', including float32 buffers that aren't aligned like
+# floats (like a memoryview of a bytearray starting at an odd byte).  It also
+# checks that run() rejects an 'out' of the wrong type or shape or that
+# partly overlaps the samples, and that run(x, n, x) doesn't leave x's buffer
+# exported.
+
+import array
+import random
+import sys
+
+import ringer
+
+FRAME_COUNT = 1000
+CHANNEL_COUNT = 4
+# includes copy counts outside the 5..200 range, which get clamped
+COPY_COUNTS = (3, 5, 16, 37, 100, 199, 250)
+
+failures = 0
+
+
+def check(passed, description):
+    global failures
+    if not passed:
+        print("FAIL: " + description)
+        failures += 1
+
+
+def expected(samples, copies, channels=1):
+    """Returns what Ringer should give for 'samples' (a flat list split into
+    'channels' rows, each row starting a new hold)."""
+    copies = min(max(copies, 5), 200)
+    frames = len(samples) // channels
+    result = []
+    for channel in range(channels):
+        row = samples[channel * frames:(channel + 1) * frames]
+        result += [row[i - i % copies] for i in range(frames)]
+    return result
+
+
+def flatten(view):
+    """Returns the samples of a 1-D or 2-D memoryview as one flat list."""
+    samples = view.tolist()
+    if view.ndim == 2:
+        samples = [x for row in samples for x in row]
+    return samples
+
+
+def as_rows(buffer, channels):
+    """Returns a channels x frames view of a flat buffer."""
+    view = memoryview(buffer)
+    return view.cast('B').cast(view.format,
+                               (channels, len(view) // channels))
+
+
+def misaligned_floats(samples, offset=1):
+    """Returns a float memoryview holding 'samples' that starts 'offset'
+    bytes into a bytearray (so it isn't aligned like floats)."""
+    raw = bytearray(offset + 4 * len(samples))
+    view = memoryview(raw)[offset:].cast('f')
+    view[:] = array.array('f', samples)
+    return view
+
+
+def check_holds(floats, ints):
+    """Runs both kinds of samples, 1-D and 2-D, in place and into 'out'."""
+    for copies in COPY_COUNTS:
+        for format, samples in (('f', floats), ('h', ints)):
+            for channels in (1, CHANNEL_COUNT):
+                what = "%s, %d channel(s), %d copies" % (format, channels,
+                                                         copies)
+                want = expected(samples, copies, channels)
+
+                buffer = array.array(format, samples)
+                ringer.run(as_rows(buffer, channels), copies)
+                check(list(buffer) == want, "in place, " + what)
+
+                buffer = array.array(format, samples)
+                out = array.array(format, [0] * len(samples))
+                ringer.run(as_rows(buffer, channels), copies,
+                           as_rows(out, channels))
+                check(list(out) == want, "into out, " + what)
+                check(list(buffer) == samples, "samples changed, " + what)
+
+
+def check_misaligned(floats):
+    """Runs float32 buffers that aren't aligned like floats."""
+    for copies in COPY_COUNTS:
+        want = expected(floats, copies)
+
+        view = misaligned_floats(floats)
+        ringer.run(view, copies)
+        check(view.tolist() == want, "misaligned in place, %d copies"
+              % copies)
+
+        out = array.array('f', [0.0] * len(floats))
+        ringer.run(misaligned_floats(floats), copies, out)
+        check(list(out) == want, "misaligned input, %d copies" % copies)
+
+        out = misaligned_floats([0.0] * len(floats), 3)
+        ringer.run(array.array('f', floats), copies, out)
+        check(out.tolist() == want, "misaligned output, %d copies" % copies)
+
+        view = misaligned_floats(floats).cast('B').cast(
+            'f', (CHANNEL_COUNT, len(floats) // CHANNEL_COUNT))
+        ringer.run(view, copies)
+        check(flatten(view) == expected(floats, copies, CHANNEL_COUNT),
+              "misaligned %d channels, %d copies" % (CHANNEL_COUNT, copies))
+
+
+def check_rejected(function, error, description):
+    try:
+        function()
+    except error:
+        return
+    except Exception as other:
+        check(False, "%s raised %s" % (description, type(other).__name__))
+        return
+    check(False, description + " was accepted")
+
+
+def check_errors(floats):
+    """Checks the 'out' buffers run() has to refuse."""
+    samples = array.array('f', floats)
+    rows = as_rows(samples, CHANNEL_COUNT)
+
+    check_rejected(lambda: ringer.run(samples, 5,
+                                      array.array('h', [0] * len(floats))),
+                   TypeError, "out of another type")
+    check_rejected(lambda: ringer.run(samples, 5,
+                                      array.array('f', [0.0] * 10)),
+                   ValueError, "out of another length")
+    check_rejected(lambda: ringer.run(rows, 5,
+                                      array.array('f', [0.0] * len(floats))),
+                   ValueError, "1-D out for 2-D samples")
+    check_rejected(lambda: ringer.run(memoryview(samples)[:-8], 5,
+                                      memoryview(samples)[8:]),
+                   ValueError, "out overlapping samples")
+    check_rejected(lambda: ringer.run(bytearray(16)), TypeError,
+                   "samples of bytes")
+
+
+def check_aliasing():
+    """run(x, n, x) has to let go of x's buffer again, so x can be
+    resized."""
+    raw = bytearray(4 * FRAME_COUNT)
+    view = memoryview(raw).cast('f')
+    ringer.run(view, 5, view)
+    try:
+        view.release()
+        raw.extend(b"\0" * 4)
+    except BufferError:
+        check(False, "run(x, n, x) left x's buffer exported")
+
+
+def main():
+    random.seed(1)
+    # round through float32 so the comparisons are exact
+    floats = list(array.array('f', [random.uniform(-1.0, 1.0)
+                                    for _ in range(FRAME_COUNT)]))
+    ints = [random.randint(-32768, 32767) for _ in range(FRAME_COUNT)]
+
+    check_holds(floats, ints)
+    check_misaligned(floats)
+    check_errors(floats)
+    check_aliasing()
+
+    if failures:
+        sys.exit(1)
+    print("PASS: ringer.run() holds, misaligned buffers, errors, aliasing")
+
+
+if __name__ == "__main__":
+    main()